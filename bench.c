@@ -0,0 +1,603 @@
+/*
+ * Benchmarks for the fitz engine. fitz.c is included directly, with its
+ * main left out, so that the engine's internal functions can be timed on
+ * their own. Each benchmark runs over a range of board sizes and fill
+ * densities and prints one line per case with its ns/op and ops/sec.
+ *
+ * Usage: fitz_bench [tilefile]
+ */
+#define FITZ_BENCH
+#include "fitz.c"
+
+#define BENCH_PROBES (1 << 18)
+#define BENCH_SEED 2310
+#define BENCH_MIN_SECONDS 0.2
+#define BENCH_SIZES 3
+#define BENCH_FILLS 4
+#define BENCH_SAVE_FORMATS 3
+#define SCAN_PLAYER_MAX_SIZE 200
+#define BENCH_SEARCH_MS 100
+
+#if defined(__AVX2__)
+#define VECTOR_KERNEL "avx2"
+#elif defined(__SSE2__)
+#define VECTOR_KERNEL "sse2"
+#else
+#define VECTOR_KERNEL "scalar"
+#endif
+
+/*
+ * Struct Datatype used to hold one pre-generated fit check: the rotation
+ * tested and the board coordinates of its top left corner.
+ */
+typedef struct Probe {
+    Rotation* rotation;
+    int rowOffset;
+    int colOffset;
+} Probe;
+
+/*
+ * Names of the save formats, and the files each is benchmarked with.
+ */
+char* saveFormats[BENCH_SAVE_FORMATS] = {"text", "binary", "rle"};
+char* saveFiles[BENCH_SAVE_FORMATS] = {"fitz_bench.save", "fitz_bench.bsave",
+        "fitz_bench.rsave"};
+
+/*
+ * Struct Datatype used to hold everything one benchmark case works on:
+ * the tiles and tile file, a board filled to some density (with its legal
+ * move index), the probes to try on it, the players of a full game, the 
+ * format it is saved and loaded in, and an arena for scratch memory and 
+ * full games.
+ */
+typedef struct BenchCase {
+    char* tileName;
+    Tile** tiles;
+    int numTiles;
+    Board grid;
+    int size;
+    int percent;
+    Probe* probes;
+    Player players[2];
+    int saveFormat;
+    Arena arena;
+    long sink;
+} BenchCase;
+
+/*
+ * Fit check kernel signature, shared by tile_fits and its variants.
+ */
+typedef int (*FitKernel)(Board*, Rotation*, int, int);
+
+/*
+ * Benchmark operation signature. Takes the case being timed and the number
+ * of the operation, and performs that operation once.
+ */
+typedef void (*BenchOp)(BenchCase*, long);
+
+uint64_t bench_random(uint64_t* state);
+
+void fill_board(Board* grid, int percent, uint64_t* state);
+
+void make_probes(Board* grid, Tile** tiles, int numTiles, Probe* probes,
+        int count, uint64_t* state);
+
+void setup_case(BenchCase* bench, int size, int percent);
+
+double time_op(BenchCase* bench, BenchOp op);
+
+double time_probes(Board* grid, Probe* probes, int count, FitKernel kernel,
+        long* fits);
+
+void report(char* name, BenchCase* bench, double nanoseconds);
+
+void op_rotate_tile(BenchCase* bench, long op);
+
+void op_game_over(BenchCase* bench, long op);
+
+void op_game_over_scan(BenchCase* bench, long op);
+
+void op_greedy_move(BenchCase* bench, long op);
+
+void op_scan_board(BenchCase* bench, long op);
+
+void op_full_game(BenchCase* bench, long op);
+
+void op_load_tiles(BenchCase* bench, long op);
+
+void op_save_game(BenchCase* bench, long op);
+
+void op_load_game(BenchCase* bench, long op);
+
+void bench_probes(BenchCase* bench);
+
+void bench_prefix_counts(BenchCase* bench);
+
+int tile_fits_prefix(Board* grid, Rotation* rotation, int rowOffset,
+        int colOffset);
+
+void bench_attempt_place(BenchCase* bench);
+
+void bench_search(BenchCase* bench);
+
+void bench_mcts(BenchCase* bench);
+
+void set_players(BenchCase* bench, char type);
+
+void bench_games(BenchCase* bench, char* name, char type);
+
+int main(int argc, char** argv) {
+    int sizes[BENCH_SIZES] = {10, 100, 999};
+    int percents[BENCH_FILLS] = {0, 30, 60, 90};
+    DataReadFlag benchFlag = {0};
+    FILE* tileFile = NULL;
+    BenchCase bench;
+
+    bench.tileName = (argc > 1) ? argv[1] : "tilefile";
+    bench.tiles = load_tiles(&tileFile, &benchFlag, bench.tileName,
+            &(bench.numTiles));
+    bench.probes = (Probe*) malloc(sizeof(Probe) * BENCH_PROBES);
+    bench.size = bench.percent = 0;
+    arena_init(&(bench.arena));
+    set_players(&bench, '2');
+    report("rotate_tile", &bench, time_op(&bench, op_rotate_tile));
+    report("load_tiles", &bench, time_op(&bench, op_load_tiles));
+
+    for (int s = 0; s < BENCH_SIZES; s++) {
+        for (int p = 0; p < BENCH_FILLS; p++) {
+            setup_case(&bench, sizes[s], percents[p]);
+            bench_probes(&bench);
+            bench_prefix_counts(&bench);
+            report("check_game_over/index", &bench,
+                    time_op(&bench, op_game_over));
+            report("check_game_over/scan", &bench,
+                    time_op(&bench, op_game_over_scan));
+            report("choose_greedy_move", &bench,
+                    time_op(&bench, op_greedy_move));
+            report("scan_steps", &bench, time_op(&bench, op_scan_board));
+            bench_search(&bench);
+            bench_mcts(&bench);
+            for (int f = 0; f < BENCH_SAVE_FORMATS; f++) {
+                char name[32];
+                bench.saveFormat = f;
+                sprintf(name, "attempt_save/%s", saveFormats[f]);
+                report(name, &bench, time_op(&bench, op_save_game));
+                sprintf(name, "load_game/%s", saveFormats[f]);
+                report(name, &bench, time_op(&bench, op_load_game));
+            }
+            bench_attempt_place(&bench); //Fills the board; goes last
+            free_grid(&(bench.grid));
+        }
+        bench.size = sizes[s];
+        bench.percent = 0;
+        bench_games(&bench, "auto_play_one/game", '1');
+        bench_games(&bench, "auto_play_two/game", '2');
+        bench_games(&bench, "auto_play_three/game", '3');
+    }
+
+    for (int f = 0; f < BENCH_SAVE_FORMATS; f++) {
+        remove(saveFiles[f]);
+    }
+    free(bench.probes);
+    arena_free(&(bench.arena));
+    return 0;
+}
+
+/*
+ * Takes the state of a xorshift generator, advances it and returns the
+ * next pseudo random number. Keeps every run of the benchmarks the same.
+ */
+uint64_t bench_random(uint64_t* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+/*
+ * Takes an empty board, a fill percentage and a generator state, and
+ * gives roughly that percentage of cells to a random player.
+ */
+void fill_board(Board* grid, int percent, uint64_t* state) {
+    for (int i = 0; i < grid->height; i++) {
+        for (int j = 0; j < grid->width; j++) {
+            if ((int) (bench_random(state) % 100) < percent) {
+                set_cell(grid, i, j, (bench_random(state) & 1) ? '*' : '#');
+            }
+        }
+    }
+}
+
+/*
+ * Takes a board, the tiles, an array of probes to fill and its length,
+ * and a generator state. Fills the array with probes of random tile
+ * rotations centred anywhere an automatic player might try.
+ */
+void make_probes(Board* grid, Tile** tiles, int numTiles, Probe* probes,
+        int count, uint64_t* state) {
+    for (int i = 0; i < count; i++) {
+        Tile* tile = tiles[bench_random(state) % numTiles];
+        probes[i].rotation =
+                &(tile->rotations[bench_random(state) % tile->rotationCount]);
+        probes[i].rowOffset = (int) (bench_random(state) %
+                (grid->height + 5)) - 2 - TILE_CENTRE;
+        probes[i].colOffset = (int) (bench_random(state) %
+                (grid->width + 5)) - 2 - TILE_CENTRE;
+    }
+}
+
+/*
+ * Setup function. Takes a benchmark case with its tiles loaded, a board
+ * size and a fill percentage. Creates a square board of that size filled
+ * to that density, indexes it and generates probes for it.
+ */
+void setup_case(BenchCase* bench, int size, int percent) {
+    uint64_t state = BENCH_SEED;
+
+    bench->size = size;
+    bench->percent = percent;
+    create_new_grid(size, size, &(bench->grid));
+    fill_board(&(bench->grid), percent, &state);
+    build_move_index(&(bench->grid), bench->tiles, bench->numTiles);
+    make_probes(&(bench->grid), bench->tiles, bench->numTiles,
+            bench->probes, BENCH_PROBES, &state);
+}
+
+/*
+ * Timing function. Takes a benchmark case and an operation, and runs the
+ * operation on the case, doubling the number of runs until they take at
+ * least BENCH_MIN_SECONDS. Returns the time taken per run in nanoseconds.
+ */
+double time_op(BenchCase* bench, BenchOp op) {
+    for (long ops = 1; ; ops *= 2) {
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (long i = 0; i < ops; i++) {
+            op(bench, i);
+        }
+
+        double seconds = elapsed_seconds(&start);
+        if (seconds >= BENCH_MIN_SECONDS) {
+            return seconds * 1e9 / ops;
+        }
+    }
+}
+
+/*
+ * Takes a board, an array of probes and its length, and a fit check
+ * kernel. Runs the kernel over every probe, storing how many fit. Returns
+ * the time taken per probe in nanoseconds.
+ */
+double time_probes(Board* grid, Probe* probes, int count, FitKernel kernel,
+        long* fits) {
+    struct timespec start;
+    *fits = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < count; i++) {
+        *fits += kernel(grid, probes[i].rotation, probes[i].rowOffset,
+                probes[i].colOffset);
+    }
+    return elapsed_seconds(&start) * 1e9 / count;
+}
+
+/*
+ * Printing function. Takes a benchmark name, the case it ran on and the
+ * time per operation, and prints a result line with ns/op and ops/sec.
+ * Cases that don't depend on a board print no board size.
+ */
+void report(char* name, BenchCase* bench, double nanoseconds) {
+    if (bench->size == 0) {
+        printf("%-24s %19s", name, "");
+    } else {
+        printf("%-24s %4dx%-4d fill %3d%%", name, bench->size, bench->size,
+                bench->percent);
+    }
+    printf(" %14.1f ns/op %14.1f ops/sec\n", nanoseconds,
+            1e9 / nanoseconds);
+    fflush(stdout);
+}
+
+/*
+ * Operation: rotates a tile by a number of quarter turns.
+ */
+void op_rotate_tile(BenchCase* bench, long op) {
+    Tile rotated = rotate_tile(bench->tiles[op % bench->numTiles],
+            (int) (op % ROTATION_COUNT));
+    bench->sink += rotated.tileData[0][0];
+}
+
+/*
+ * Operation: checks for a legal move using the board's move index.
+ */
+void op_game_over(BenchCase* bench, long op) {
+    bench->sink += check_game_over(&(bench->grid),
+            bench->tiles[op % bench->numTiles]);
+}
+
+/*
+ * Operation: checks for a legal move by scanning the board, as fitz does
+ * when a board is too large to index.
+ */
+void op_game_over_scan(BenchCase* bench, long op) {
+    MoveIndex* index = bench->grid.index;
+    bench->grid.index = NULL;
+    bench->sink += check_game_over(&(bench->grid),
+            bench->tiles[op % bench->numTiles]);
+    bench->grid.index = index;
+}
+
+/*
+ * Operation: picks a type 3 player's move for a tile, against the tile 
+ * after it, without playing it.
+ */
+void op_greedy_move(BenchCase* bench, long op) {
+    Placement move;
+    bench->sink += choose_greedy_move(&(bench->grid),
+            bench->tiles[op % bench->numTiles],
+            bench->tiles[(op + 1) % bench->numTiles], &(bench->arena), 
+            &move);
+}
+
+/*
+ * Operation: searches the case's board for a type 2 player one's move of
+ * one of the tiles, from the top left corner, without placing it. Crowded 
+ * boards leave most of the board for the search to pass over.
+ */
+void op_scan_board(BenchCase* bench, long op) {
+    Tile* tile = bench->tiles[op % bench->numTiles];
+    ScanOrder order;
+
+    init_scan_order(&order, &(bench->grid), tile, -2, -2, 1);
+    order.anglesFirst = 0;
+    for (int k = 0; k < tile->rotationCount; k++) {
+        order.angles[order.angleCount++] = tile->rotations[k].angle;
+    }
+    order.total = order.positions * order.angleCount;
+    bench->sink += scan_steps(&order, 0, order.total);
+}
+
+/*
+ * Operation: plays a full unprinted game between the case's players on
+ * an empty board of the case's size, in the case's arena (reset after 
+ * the game, as batch workers do).
+ */
+void op_full_game(BenchCase* bench, long op) {
+    GameState game;
+    new_game(&game, bench->tiles, bench->numTiles, &(bench->players[0]),
+            &(bench->players[1]), 0);
+    game.arena = bench->arena;
+    create_arena_grid(bench->size, bench->size, &(game.grid), 
+            &(game.arena));
+    main_game_loop(&game);
+    bench->sink += game.moveCount;
+    bench->arena = game.arena;
+    arena_reset(&(bench->arena));
+}
+
+/*
+ * Operation: loads the tile file and frees the tiles again.
+ */
+void op_load_tiles(BenchCase* bench, long op) {
+    DataReadFlag loadFlag = {0};
+    FILE* tileFile = NULL;
+    int numTiles = 0;
+    Tile** tiles = load_tiles(&tileFile, &loadFlag, bench->tileName,
+            &numTiles);
+
+    free_tiles(tiles);
+    bench->sink += numTiles;
+}
+
+/*
+ * Operation: saves the case's board to the benchmark save file for the 
+ * case's save format, building binary saves in the case's arena.
+ */
+void op_save_game(BenchCase* bench, long op) {
+    char saveInput[MAX_INPUT];
+    char* input = saveInput;
+    GameState game;
+
+    new_game(&game, bench->tiles, bench->numTiles, &(bench->players[0]),
+            &(bench->players[1]), 0);
+    game.grid = bench->grid;
+    game.saveFormat = bench->saveFormat;
+    game.arena = bench->arena;
+    sprintf(saveInput, "save%s", saveFiles[bench->saveFormat]);
+    attempt_save(&game, &input);
+    bench->arena = game.arena;
+}
+
+/*
+ * Operation: loads the case's board back from the benchmark save file for
+ * the case's save format, into the case's arena.
+ */
+void op_load_game(BenchCase* bench, long op) {
+    DataReadFlag loadFlag = {0};
+    FILE* saveFile = NULL;
+    GameState game;
+
+    new_game(&game, bench->tiles, bench->numTiles, &(bench->players[0]),
+            &(bench->players[1]), 0);
+    game.arena = bench->arena;
+    load_game(saveFiles[bench->saveFormat], &game, &loadFlag, &saveFile);
+    bench->sink += game.grid.height;
+    bench->arena = game.arena;
+    arena_reset(&(bench->arena));
+}
+
+/*
+ * Fit check benchmark. Takes a set up case, and times the scalar and
+ * vector fit check kernels on its probes, checking that both give the
+ * same answers.
+ */
+void bench_probes(BenchCase* bench) {
+    long scalarFits = 0, vectorFits = 0;
+
+    report("tile_fits/scalar", bench, time_probes(&(bench->grid),
+            bench->probes, BENCH_PROBES, tile_fits_scalar, &scalarFits));
+    report("tile_fits/" VECTOR_KERNEL, bench, time_probes(&(bench->grid),
+            bench->probes, BENCH_PROBES, tile_fits, &vectorFits));
+    if (scalarFits != vectorFits) {
+        printf("tile_fits kernels disagree: %ld vs %ld fits\n",
+                scalarFits, vectorFits);
+    }
+}
+
+/*
+ * Prefix count benchmark. Takes a set up case, gives its board prefix 
+ * counts and times the fit check can_place makes with them on the case's
+ * probes, checking it gives the same answers as without. Also reports the
+ * share of the probes that don't fit which the counts alone turn down.
+ * Takes the counts off the board again afterwards.
+ */
+void bench_prefix_counts(BenchCase* bench) {
+    long plainFits = 0, prefixFits = 0, rejected = 0;
+
+    time_probes(&(bench->grid), bench->probes, BENCH_PROBES, tile_fits,
+            &plainFits);
+    build_prefix_counts(&(bench->grid));
+    report("tile_fits/prefix", bench, time_probes(&(bench->grid),
+            bench->probes, BENCH_PROBES, tile_fits_prefix, &prefixFits));
+    if (plainFits != prefixFits) {
+        printf("prefix counts disagree: %ld vs %ld fits\n", plainFits,
+                prefixFits);
+    }
+
+    for (int i = 0; i < BENCH_PROBES; i++) {
+        Probe* probe = &(bench->probes[i]);
+        rejected += !enough_free(&(bench->grid), probe->rotation,
+                probe->rowOffset, probe->colOffset);
+    }
+    if (plainFits < BENCH_PROBES) {
+        printf("%-24s %4dx%-4d fill %3d%% %14.1f%% of misses rejected\n",
+                "prefix_counts/reject", bench->size, bench->size,
+                bench->percent, 100.0 * rejected / (BENCH_PROBES - plainFits));
+    }
+    free_prefix_counts(&(bench->grid));
+}
+
+/*
+ * Fit check kernel, as per tile_fits, which first turns down what it can
+ * with the board's prefix counts, as can_place does.
+ */
+int tile_fits_prefix(Board* grid, Rotation* rotation, int rowOffset,
+        int colOffset) {
+    return enough_free(grid, rotation, rowOffset, colOffset) &&
+            tile_fits(grid, rotation, rowOffset, colOffset);
+}
+
+/*
+ * Placement benchmark. Takes a set up case, and times attempt_place (and
+ * the move index updates that come with it) over the case's probes once.
+ * As tiles are placed the board fills up, so the case's fill percentage
+ * is only the density the run starts from.
+ */
+void bench_attempt_place(BenchCase* bench) {
+    struct timespec start;
+    Player* player = &(bench->players[0]);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < BENCH_PROBES; i++) {
+        Probe* probe = &(bench->probes[i]);
+        bench->sink += attempt_place(probe->rowOffset + TILE_CENTRE,
+                probe->colOffset + TILE_CENTRE, probe->rotation,
+                &(bench->grid), player);
+    }
+    report("attempt_place", bench,
+            elapsed_seconds(&start) * 1e9 / BENCH_PROBES);
+}
+
+/*
+ * Search benchmark. Takes a set up case and runs one type 4 player search
+ * of its board for BENCH_SEARCH_MS milliseconds, timing each node searched
+ * (so ops/sec is nodes per second). Also checks the counts the search 
+ * scores positions with agree with the board's legal move index.
+ */
+void bench_search(BenchCase* bench) {
+    GameState game;
+    Search search;
+    Placement move;
+
+    new_game(&game, bench->tiles, bench->numTiles, &(bench->players[0]),
+            &(bench->players[1]), 0);
+    game.grid = bench->grid;
+    game.searchTime = BENCH_SEARCH_MS;
+    init_search(&search, &game);
+    bench->sink += choose_search_move(&search, &move);
+    report("alpha_beta/node", bench,
+            elapsed_seconds(&(search.start)) * 1e9 / search.nodes);
+    free_search(&search);
+    arena_free(&(game.arena));
+
+    for (int t = 0; t < bench->numTiles && bench->grid.index != NULL; t++) {
+        Shape* shape = bench->tiles[t]->shape;
+        if (count_placements(&(bench->grid), shape) != 
+                bench->grid.index->legalCount[shape->id]) {
+            printf("count_placements disagrees with the move index\n");
+        }
+    }
+}
+
+/*
+ * Monte Carlo benchmark. Takes a set up case and runs one type 5 player 
+ * search of its board for BENCH_SEARCH_MS milliseconds, timing each 
+ * playout (so ops/sec is playouts per second). Each playout plays a whole
+ * game out, so boards larger than SCAN_PLAYER_MAX_SIZE are skipped.
+ */
+void bench_mcts(BenchCase* bench) {
+    GameState game;
+    Placement move;
+    long playouts = 0;
+    double seconds = 0;
+
+    if (bench->size > SCAN_PLAYER_MAX_SIZE) {
+        return;
+    }
+    new_game(&game, bench->tiles, bench->numTiles, &(bench->players[0]),
+            &(bench->players[1]), 0);
+    game.grid = bench->grid;
+    game.searchTime = BENCH_SEARCH_MS;
+    bench->sink += choose_mcts_move(&game, &move, &playouts, &seconds);
+    report("mcts/playout", bench, seconds * 1e9 / playouts);
+    arena_free(&(game.arena));
+}
+
+/*
+ * Takes a benchmark case and an automatic player type, and makes both of
+ * the case's players that type.
+ */
+void set_players(BenchCase* bench, char type) {
+    DataReadFlag playerFlag = {0};
+    char typeName[2] = {type, '\0'};
+
+    for (int i = 0; i < 2; i++) {
+        Player* player = create_player(typeName, NULL, &playerFlag, i + 1);
+        bench->players[i] = *player;
+        free(player);
+    }
+}
+
+/*
+ * Game benchmark. Takes a case with its board size set, a benchmark name
+ * and an automatic player type, and times full games between two players
+ * of that type. Type 1 players restart their search from the top of the
+ * board every move, and type 3 players try the whole board every move, so
+ * their games are skipped on boards larger than SCAN_PLAYER_MAX_SIZE.
+ * Then plays one more game and checks it made no heap allocations, now 
+ * that the case's arena has grown to fit a game.
+ */
+void bench_games(BenchCase* bench, char* name, char type) {
+    if (type != '2' && bench->size > SCAN_PLAYER_MAX_SIZE) {
+        return;
+    }
+    set_players(bench, type);
+    report(name, bench, time_op(bench, op_full_game));
+
+    long heapAllocations = bench->arena.heapAllocations;
+    op_full_game(bench, 0);
+    if (bench->arena.heapAllocations != heapAllocations) {
+        printf("%s made %ld heap allocations in a warm arena\n", name,
+                bench->arena.heapAllocations - heapAllocations);
+    }
+}
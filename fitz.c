@@ -1,7 +1,19 @@
+#define _POSIX_C_SOURCE 200809L
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <ctype.h>
+#include <stdint.h>
+#include <time.h>
+#include <math.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
 
 #define TILE_HEIGHT 5
 #define TILE_WIDTH 5
@@ -11,9 +23,40 @@
 #define INVALID_TILE_CONTENTS 3
 #define INVALID_PLAYER 4
 #define INVALID_BOARD_PARAM 5
-#define PLAYER_TYPES "h12"
+#define PLAYER_TYPES "h12345"
 #define INVALID_SAVE_FILE 6
 #define INVALID_SAVE_CONTENT 7
+#define INVALID_BATCH_ARGS 8
+#define INVALID_REPLAY_ARGS 9
+#define BATCH_FLAG "--batch"
+#define BATCH_ARGS 8
+#define REPLAY_FLAG "--replay"
+#define REPLAY_ARGS 4
+#define SEARCH_THREADS_FLAG "--search-threads"
+#define DIFF_RENDER_FLAG "--diff-render"
+#define ROW_LABEL_WIDTH 5
+#define SAVE_FORMAT_FLAG "--save-format"
+#define TEXT_SAVE 0
+#define BINARY_SAVE 1
+#define RLE_SAVE 2
+#define BINARY_MAGIC "FITZ"
+#define BINARY_VERSION 1
+#define PACKED_BOARD 0
+#define RLE_BOARD 1
+#define CELL_CODE_COUNT 3
+#define RUN_CODE_BITS 2
+#define MAX_VARINT_BYTES 5
+#define MAX_ROW_BYTES ((MAX_WIDTH + 3) / 4)
+#define JOURNAL_FLAG "--journal"
+#define JOURNAL_MAGIC "FJNL"
+#define JOURNAL_VERSION 1
+#define JOURNAL_RECORD 10
+#define BINARY_HEADER 16
+#define CHECKSUM_BYTES 4
+#define FNV_OFFSET 2166136261u
+#define FNV_PRIME 16777619u
+#define SEARCH_BLOCK 4096
+#define PARALLEL_MIN_PROBES (4 * SEARCH_BLOCK)
 #define END_OF_INPUT 10
 #define ROTATION_STEP 90 
 #define TILE_FILE 't'
@@ -23,15 +66,182 @@
 #define MAX_ANGLE 270
 #define MAX_WIDTH 999
 #define MAX_HEIGHT 999
+#define BOARD_PAD 5
+#define WORD_BITS 64
+#define PLANE_COUNT 3
+#define OCCUPIED_PLANE 0
+#define TILE_ROW_MASK 0x1F
+#define TILE_CELLS 25
+#define TILE_RECORD (TILE_HEIGHT * (TILE_WIDTH + 1))
+#define SIMD_ROWS 8
+#define MAX_INDEX_WORDS (1 << 23)
+#define SHAPE_HASH 2654435761u
+#define GREEDY_PAD (2 * TILE_HEIGHT)
+#define MAX_OVERLAPS ((2 * TILE_HEIGHT - 1) * (2 * TILE_WIDTH - 1))
+#define MAX_ROW_WORDS ((MAX_WIDTH + 2 * BOARD_PAD + WORD_BITS - 1) / \
+        WORD_BITS + 1)
+#define SEARCH_TIME_FLAG "--search-time"
+#define SEARCH_TIME_MS 100
+#define SEARCH_TABLE_BITS 16
+#define SEARCH_CHECK_NODES 16
+#define MAX_SEARCH_DEPTH 32
+#define WIN_SCORE (1 << 28)
+#define EXACT_BOUND 0
+#define LOWER_BOUND 1
+#define UPPER_BOUND 2
+#define ZOBRIST_TILE ((uint64_t) 1 << 32)
+#define ZOBRIST_SIDE ((uint64_t) 1 << 33)
+#define PLAYOUTS_FLAG "--playouts"
+#define MCTS_CHILDREN 32
+#define MCTS_EXPLORATION 1.4
+#define MAX_MCTS_DEPTH 64
+#define MCTS_SEED 2310
+#define MCTS_MAX_NODES (1 << 18)
+#define ARENA_ALIGN 16
+#define ARENA_HEADER ((sizeof(ArenaBlock) + ARENA_ALIGN - 1) & \
+        ~(size_t) (ARENA_ALIGN - 1))
+#define ARENA_MIN_BLOCK (1 << 16)
+#define PREFIX_COUNTS_FLAG "--prefix-counts"
+#define STATS_FLAG "--stats"
+
+/*
+ * Struct Datatype used to hold one distinct rotation of a tile.
+ * This includes:
+ *      -  Packed mask of the filled cells, bit (row * TILE_WIDTH + col)
+ *      -  Angle of the first rotation that produces this shape
+ *      -  Bounding box rows and columns of the filled cells (top > bottom
+ *         when the tile has no filled cells)
+ *      -  The mask split into one word per tile row, padded with empty
+ *         rows to SIMD_ROWS so vector loads never run past the end
+ */
+typedef struct Rotation {
+    uint32_t mask;
+    int angle;
+    int top;
+    int bottom;
+    int left;
+    int right;
+    uint64_t rows[SIMD_ROWS];
+} Rotation;
+
+/*
+ * Struct Datatype used to hold a tile shape up to rotation and translation,
+ * shared by every tile in the tilefile with that shape. This includes:
+ *      -  Number of the shape, counting from 0 in order of first appearance
+ *      -  Canonical mask: the smallest packed mask of any of the shape's 
+ *         rotations once moved to the top left corner of the tile
+ *      -  Number of distinct rotations once moved to the top left corner
+ *      -  Those distinct rotations, each with its bounding box at (0, 0)
+ */
+typedef struct Shape {
+    int id;
+    uint32_t mask;
+    int rotationCount;
+    Rotation rotations[ROTATION_COUNT];
+} Shape;
 
 /*
  * Struct Datatype used to hold a 2D array containing the chars which make
- * up a singular tile. 
+ * up a singular tile, along with its precomputed rotation table:
+ *      -  Position of the tile within the tilefile
+ *      -  Number of distinct rotations (symmetric tiles have fewer than 4)
+ *      -  Index into the distinct rotations for each 90 degree step
+ *      -  The distinct rotations, in order of their first angle
+ *      -  The canonical shape of the tile
  */
 typedef struct Tile { 
     char tileData[TILE_HEIGHT][TILE_WIDTH]; 
+    int id;
+    int rotationCount;
+    int rotationOf[ROTATION_COUNT];
+    Rotation rotations[ROTATION_COUNT];
+    Shape* shape;
 } Tile;
 
+/*
+ * Struct Datatype used to hold the legal placements of every tile shape on
+ * a board, kept up to date as tiles are played. Tiles with the same shape
+ * share its entries. This includes:
+ *      -  The shapes being indexed, and how many there are
+ *      -  Number of legal placements of each shape over all its rotations
+ *      -  One bitmap per shape rotation, laid out like a board plane, with
+ *         a bit set for every board position where the top left corner 
+ *         of the rotation's bounding box gives a legal placement
+ */
+typedef struct MoveIndex {
+    Shape* shapes;
+    int numShapes;
+    long* legalCount;
+    uint64_t* legal;
+} MoveIndex;
+
+/*
+ * Struct Datatype used to hold one block of memory taken from the heap by
+ * an arena: the block taken before it (NULL if none) and the number of 
+ * bytes it holds. The bytes follow ARENA_HEADER bytes after the start of
+ * the block.
+ */
+typedef struct ArenaBlock {
+    struct ArenaBlock* previous;
+    size_t size;
+} ArenaBlock;
+
+/*
+ * Struct Datatype used to hand out the memory one game needs (its board,
+ * move index, input buffer and every move's scratch memory) from a few 
+ * large blocks instead of the heap. This includes:
+ *      -  The newest block (NULL until the first allocation) and the 
+ *         number of its bytes handed out
+ *      -  Total size of every block
+ *      -  Number of blocks taken from the heap, and number of allocations
+ *         handed out, over the arena's life
+ * Memory is only given back all at once: to a mark (see arena_mark), or
+ * by a reset, which also merges the blocks into one so the next game of
+ * the same size needs no heap allocations at all.
+ */
+typedef struct Arena {
+    ArenaBlock* block;
+    size_t used;
+    size_t total;
+    long heapAllocations;
+    long allocations;
+} Arena;
+
+/*
+ * Struct Datatype used to remember how much of an arena was in use, so 
+ * that everything allocated after it can be given back at once.
+ */
+typedef struct ArenaMark {
+    ArenaBlock* block;
+    size_t used;
+} ArenaMark;
+
+/*
+ * Struct Datatype used to hold a fitz game board as bit-packed occupancy
+ * masks (planes), all stored in one contiguous allocation:
+ *      -  Plane 0 marks every occupied cell, along with a wall of BOARD_PAD
+ *         cells around the board so off board cells read as occupied
+ *      -  Plane 1 marks the cells held by player one ('*')
+ *      -  Plane 2 marks the cells held by player two ('#')
+ * Every padded row of a plane is rowWords 64 bit words long, with bit
+ * (col + BOARD_PAD) holding column col, and one spare word at the end so
+ * the word after any tile window can always be read. A board may also 
+ * carry a legal move index which attempt_place keeps in step with it 
+ * (NULL if not), running counts of occupied cells along each padded row
+ * which it also keeps in step, for can_place to turn down moves with 
+ * (NULL if not kept; see build_prefix_counts), and the arena its memory
+ * came from (NULL if it came from the heap).
+ */
+typedef struct Board {
+    int height;
+    int width;
+    int rowWords;
+    uint64_t* planes;
+    MoveIndex* index;
+    int* prefix;
+    Arena* arena;
+} Board;
+
 /*
  * Struct Datatype used throughout program to indicate current program status
  * using a singular int as the exit status
@@ -41,27 +251,74 @@ typedef struct DataReadFlags {
 } DataReadFlag;
 
 /*
- * Struct Datatype used to store the current fitz game information for saving;
- * This includes:
- *      -  Number of next tile to be played from tilefile (>= 0) 
- *      -  Next player to have their turn (0, 1)
- *      -  Number of rows in the current fitz game
- *      -  Number of columns in the current fitz game
- *      -  2D array copy of the current state of fitz game board
- *
+ * Struct Datatype used to describe a single tile placement: the row and 
+ * column of the centre of the tile, and the angle it is rotated by.
  */
-typedef struct GameState { 
-    int currentTile;  
-    int currentPlayer;
-    int gridHeight;
-    int gridWidth;
-    char** grid;
-} GameState;
+typedef struct Placement {
+    int row;
+    int col;
+    int angle;
+} Placement;
+
+/*
+ * Struct Datatype used to describe the order an automatic player searches
+ * the board in, as a numbered sequence of (position, angle) steps so the
+ * search can be split up between threads. This includes:
+ *      -  The board and the tile being searched for
+ *      -  Number of positions tried per angle, and total number of steps
+ *      -  Position the search starts from, counted row by row from 
+ *         (-2, -2), and whether it moves forwards (1) or backwards (-1)
+ *      -  Whether every position is tried at one angle before moving to 
+ *         the next angle (type 1), or every angle at one position before 
+ *         moving to the next position (type 2)
+ *      -  The angles tried, in order
+ */
+typedef struct ScanOrder {
+    Board* grid;
+    Tile* tile;
+    long positions;
+    long total;
+    long start;
+    int direction;
+    int anglesFirst;
+    int angleCount;
+    int angles[ROTATION_COUNT];
+} ScanOrder;
+
+/*
+ * Struct Datatype used to store a pool of threads that share the work of
+ * an automatic player's search. This includes:
+ *      -  Number of worker threads, not counting the searching thread
+ *      -  The worker threads
+ *      -  Lock and conditions used to hand out searches and collect them
+ *      -  Number of the current search, and workers still busy with it
+ *      -  Whether the workers should exit
+ *      -  The current scan search, the next block of steps to hand out 
+ *         and the earliest step found to fit so far (total if none)
+ *      -  Or the trees of the current Monte Carlo search (NULL for a scan
+ *         search), how many there are and the next one to hand out
+ */
+typedef struct SearchPool {
+    int threads;
+    pthread_t* workers;
+    pthread_mutex_t lock;
+    pthread_cond_t started;
+    pthread_cond_t finished;
+    int generation;
+    int active;
+    int shutdown;
+    ScanOrder* order;
+    long nextBlock;
+    long best;
+    struct Mcts* trees;
+    int treeCount;
+    int nextTree;
+} SearchPool;
 
 /*
  * Struct Datatype used to store player information for gameplay.
  * This includes:
- *      -  player type; either 'h', '1', or '2' 
+ *      -  player type; either 'h' or '1' to '5' 
  *      -  player icon to be displayed on board
  *      -  player number; either 1 or 2
  *      -  last row played by this player
@@ -75,19 +332,448 @@ typedef struct Player {
     int lastCol;
 } Player;
 
+/*
+ * Struct Datatype used to draw a game's board. Holds the last frame drawn
+ * (one line per board row), a buffer the next frame's output is built in,
+ * whether only rows changed since the last frame are printed, and whether
+ * a frame has been drawn yet. The buffers are allocated on the first draw.
+ */
+typedef struct Renderer {
+    char* frame;
+    char* output;
+    int diff;
+    int drawn;
+} Renderer;
+
+/*
+ * Struct Datatype used to store everything about one fitz game, so that 
+ * any number of games can be played at once. Also holds the information
+ * written out on saving. This includes:
+ *      -  Number of next tile to be played from tilefile (>= 0) 
+ *      -  Next player to have their turn (0, 1)
+ *      -  The fitz game board
+ *      -  The tiles for the game (shared between games, never modified
+ *         during play) and the number of tiles
+ *      -  Both players, with their own copy of any search state
+ *      -  Last legal move position of the game, used by type 1 players
+ *      -  Status flag, set if the game had to be cut short
+ *      -  Whether the board and automatic moves are printed (0 in batch
+ *         simulations), and the renderer the board is printed with
+ *      -  Format the game is saved in (text, binary or run length coded)
+ *      -  Journal every move is appended to (NULL if not journalled)
+ *      -  Number of moves played so far
+ *      -  Thread pool for automatic player searches (NULL to search on
+ *         the calling thread only)
+ *      -  Time each type 4 or 5 move may search for, in milliseconds
+ *      -  Most playouts each type 5 move may make (0 for no limit)
+ *      -  Arena the game's board and scratch memory come from, and the 
+ *         buffer moves are read into (NULL until the first prompt)
+ *      -  Whether the board keeps prefix counts of its occupied cells
+ *      -  Whether type 4 and 5 players report each move's search to 
+ *         stderr
+ *
+ */
+typedef struct GameState { 
+    int currentTile;  
+    int currentPlayer;
+    Board grid;
+    Tile** tiles;
+    int numTiles;
+    Player players[2];
+    int lastRow;
+    int lastCol;
+    DataReadFlag flag;
+    int render;
+    Renderer renderer;
+    int saveFormat;
+    FILE* journal;
+    long moveCount;
+    SearchPool* pool;
+    int searchTime;
+    long playouts;
+    Arena arena;
+    char* input;
+    int prefixCounts;
+    int stats;
+} GameState;
+
+/*
+ * Struct Datatype used to store the options which may be given ahead of
+ * the usual commandline arguments:
+ *      -  Number of threads each automatic player search is split between
+ *      -  Whether boards are printed as only the rows changed since the
+ *         last board
+ *      -  Format games are saved in
+ *      -  File to journal the game's moves to (NULL if none)
+ *      -  Time each type 4 or 5 move may search for, in milliseconds
+ *      -  Most playouts each type 5 move may make (0 for no limit)
+ *      -  Whether boards keep prefix counts of their occupied cells
+ *      -  Whether a report of the hot path counters is printed at exit
+ */
+typedef struct Options {
+    int searchThreads;
+    int diffRender;
+    int saveFormat;
+    char* journalFile;
+    int searchTime;
+    long playouts;
+    int prefixCounts;
+    int stats;
+} Options;
+
+/*
+ * Struct Datatype used to count the work done on fitz's hot paths, for
+ * the --stats report. This includes:
+ *      -  Placement probes, and those turned down for being off the board,
+ *         by the board's prefix counts, or for colliding with played 
+ *         cells (or the wall)
+ *      -  Board words checked by the row at a time searches
+ *      -  Positions searched by type 4 players, and playouts made by 
+ *         type 5 players
+ *      -  Fit checks made building and updating legal move indexes
+ *      -  Tile rotations made
+ *      -  Game over checks, those that had to scan the board (no move 
+ *         index), and the board points those scans visited
+ *      -  Boards allocated
+ *      -  Bytes written printing boards and saving games
+ */
+typedef struct Stats {
+    long probes;
+    long outOfBounds;
+    long prefixRejects;
+    long collisions;
+    long wordChecks;
+    long searchNodes;
+    long mctsPlayouts;
+    long indexChecks;
+    long rotations;
+    long gameOverChecks;
+    long gameOverScans;
+    long cellsVisited;
+    long grids;
+    long printBytes;
+    long saveBytes;
+} Stats;
+
+#ifndef NO_STATS
+/*
+ * Hot path counters. Each thread counts into its own copy, so counting 
+ * costs one add and threads never share the counters' cache line, and 
+ * adds them to the process's totals with flush_stats. Building with
+ * -DNO_STATS compiles every count away.
+ */
+__thread Stats threadStats;
+Stats totalStats;
+pthread_mutex_t statsLock = PTHREAD_MUTEX_INITIALIZER;
+#define COUNT(counter, amount) (threadStats.counter += (amount))
+#else
+#define COUNT(counter, amount) ((void) 0)
+#endif
+
+/*
+ * Struct Datatype used to store one entry of a search player's
+ * transposition table: the hash of the position, the depth it was 
+ * searched to, its score, whether that score is exact or only a lower or
+ * upper bound, and the best move found (see encode_search_move), or -1.
+ */
+typedef struct TableEntry {
+    uint64_t key;
+    int depth;
+    int score;
+    int bound;
+    int bestMove;
+} TableEntry;
+
+/*
+ * Struct Datatype used to store a type 4 player's game tree search. 
+ * This includes:
+ *      -  A copy of the game board (with no move index) moves are made 
+ *         and unmade on
+ *      -  The game's tiles, and the number of the tile played at the root
+ *      -  Both players, and the player to move at the root
+ *      -  Zobrist hash of the board's occupied cells
+ *      -  Transposition table, and one less than its number of entries
+ *      -  Number of positions (nodes) searched, and the deepest search
+ *         finished
+ *      -  When the search started, how long it may take in seconds, and
+ *         whether it has run out of time
+ *      -  Best move found at the root so far (-1 if none)
+ *      -  Arena the board and table are taken from, and a mark of where
+ *         they start in it
+ */
+typedef struct Search {
+    Board board;
+    Tile** tiles;
+    int numTiles;
+    int rootTile;
+    Player* players;
+    int rootPlayer;
+    uint64_t hash;
+    TableEntry* table;
+    size_t tableMask;
+    long nodes;
+    int depth;
+    struct timespec start;
+    double budget;
+    int stopped;
+    int rootMove;
+    Arena* arena;
+    ArenaMark mark;
+} Search;
+
+/*
+ * Struct Datatype used to store one position being searched: the depth 
+ * left to search, its alpha and beta bounds, how many moves it is from 
+ * the root, the best score and move found so far, and the move already 
+ * searched first (-1 if none).
+ */
+typedef struct SearchNode {
+    int depth;
+    int alpha;
+    int beta;
+    int ply;
+    int best;
+    int bestMove;
+    int skipMove;
+} SearchNode;
+
+/*
+ * Struct Datatype used to store one node of a Monte Carlo search tree: the
+ * move played to reach it (see encode_search_move; -1 at the root), the
+ * number of playouts through it and how many of them the player making 
+ * that move won, and where its children start in the tree's node array 
+ * (-1 until expanded) and how many there are.
+ */
+typedef struct MctsNode {
+    int move;
+    int visits;
+    int wins;
+    int firstChild;
+    int childCount;
+} MctsNode;
+
+/*
+ * Struct Datatype used to store one thread's Monte Carlo search tree. 
+ * This includes:
+ *      -  The game being searched (only read)
+ *      -  A copy of the game board each playout is played out on
+ *      -  The tree's nodes, the root first, with how many there are and 
+ *         how many there is room for (MCTS_MAX_NODES)
+ *      -  State of the tree's random number generator
+ *      -  Playouts made, and the most it may make (0 for no limit)
+ *      -  When the search started, and how long it may take in seconds
+ */
+typedef struct Mcts {
+    GameState* game;
+    Board board;
+    MctsNode* nodes;
+    int nodeCount;
+    int nodeCapacity;
+    uint64_t random;
+    long playouts;
+    long maxPlayouts;
+    struct timespec* start;
+    double budget;
+} Mcts;
+
+/*
+ * Struct Datatype used to read a binary save, either from its contents 
+ * mapped into memory (data, size and the position reached) or, when data 
+ * is NULL, from a file a few bytes at a time through a small buffer. Also
+ * holds the checksum of every byte read so far.
+ */
+typedef struct ByteSource {
+    unsigned char* data;
+    size_t size;
+    size_t pos;
+    FILE* file;
+    unsigned char buffer[MAX_ROW_BYTES];
+    uint32_t hash;
+} ByteSource;
+
+/*
+ * Struct Datatype used to store the outcome of one batch game: whether it
+ * has finished, its board size, the winning icon, the number of moves 
+ * played, the wall time taken in seconds and the number of heap 
+ * allocations its arena made.
+ */
+typedef struct BatchResult {
+    int done;
+    int height;
+    int width;
+    char winner;
+    long moves;
+    double seconds;
+    long allocations;
+} BatchResult;
+
+/*
+ * Struct Datatype used to store a batch simulation run shared between 
+ * worker threads. This includes:
+ *      -  The tiles (read only) and number of tiles for every game
+ *      -  The template players every game starts from
+ *      -  Smallest and largest board size, and number of games to play
+ *      -  Next game to be handed to a worker, and next game to print
+ *      -  Outcome of every game
+ *      -  Lock guarding the counters, results and stdout
+ *      -  Commandline options for every game
+ */
+typedef struct BatchRun {
+    Tile** tiles;
+    int numTiles;
+    Player playerOne;
+    Player playerTwo;
+    int minSize;
+    int maxSize;
+    int games;
+    int nextGame;
+    int nextPrint;
+    BatchResult* results;
+    pthread_mutex_t lock;
+    Options options;
+} BatchRun;
+
+/*
+ * Struct Datatype used to store one move of a replayed game: the rotation
+ * of the tile played and the row and column it was played at. Together 
+ * with the player who moved, this is exactly the cells the move changed.
+ */
+typedef struct ReplayMove {
+    Rotation* rotation;
+    int row;
+    int col;
+} ReplayMove;
+
+/*
+ * Struct Datatype used to store a game being replayed from its journal:
+ *      -  The game, with its board as it stands after the current move
+ *      -  Every move in the journal and the number of moves
+ *      -  Number of moves currently played (0 to the number of moves)
+ *      -  Tile and player to move at the start of the journal
+ */
+typedef struct Replay {
+    GameState game;
+    ReplayMove* moves;
+    long total;
+    long position;
+    int startTile;
+    int startPlayer;
+} Replay;
+
 
 Tile** load_tiles(FILE** tileFile, DataReadFlag* tileFileFlag, char* tileName,
         int* numTiles);
 
+Tile** load_mapped_tiles(char* data, size_t size, DataReadFlag* loadFlag,
+        int* numTiles);
+
+int check_tile_record(const char* record);
+
+Tile** index_tiles(Tile* block, int numTiles);
+
+void intern_shapes(Tile* block, int numTiles);
+
+void canonical_shape(Tile* tile, Shape* shape);
+
+void normalise_rotation(Rotation* rotation, Rotation* normal);
+
+void free_tiles(Tile** tiles);
+
 void print_rotations(Tile** tiles, int numTiles);
 
 Tile rotate_tile(Tile* tileStart, int numRotations);
 
+void build_rotations(Tile* tile);
+
+void set_rotation(Rotation* rotation, Tile* rotated, int angle);
+
+Rotation* tile_rotation(Tile* tile, int angle);
+
+int next_rotation_angle(Tile* tile, int angle);
+
 void print_tile_rotations(int numTiles, Tile tiles[numTiles][ROTATION_COUNT]);
 
-void create_new_grid(int height, int width, char*** grid);
+void create_new_grid(int height, int width, Board* grid);
+
+void create_arena_grid(int height, int width, Board* grid, Arena* arena);
+
+void* board_calloc(Board* grid, size_t count, size_t size);
+
+void arena_init(Arena* arena);
+
+void* arena_alloc(Arena* arena, size_t bytes);
+
+void* arena_calloc(Arena* arena, size_t count, size_t size);
+
+void arena_grow(Arena* arena, size_t size);
+
+ArenaMark arena_mark(Arena* arena);
+
+void arena_release(Arena* arena, ArenaMark mark);
+
+void arena_reset(Arena* arena);
+
+void arena_free(Arena* arena);
+
+uint64_t* board_row(Board* board, int plane, int row);
+
+unsigned int board_window(Board* board, int plane, int row, int col);
+
+void board_stamp(Board* board, int plane, int row, int col, 
+        unsigned int bits);
+
+void board_clear(Board* board, int plane, int row, int col, 
+        unsigned int bits);
+
+char get_cell(Board* board, int row, int col);
+
+void set_cell(Board* board, int row, int col, char icon);
+
+int icon_plane(char icon);
+
+int test_bit(uint64_t* rowBits, int col);
+
+void build_move_index(Board* grid, Tile** tiles, int numTiles);
+
+uint64_t* index_row(Board* grid, int shapeNum, int rotation, int row);
+
+void index_shape(Board* grid, Shape* shape);
+
+void update_move_index(Board* grid, Rotation* placed, int rowOffset, 
+        int colOffset);
 
-void print_grid(int height, int width, char** grid);
+void free_move_index(Board* grid);
+
+void build_prefix_counts(Board* grid);
+
+int* prefix_row(Board* grid, int row);
+
+void update_prefix_counts(Board* grid, int firstRow, int lastRow);
+
+int enough_free(Board* grid, Rotation* rotation, int rowOffset, 
+        int colOffset);
+
+void free_prefix_counts(Board* grid);
+
+int tile_fits(Board* board, Rotation* rotation, int rowOffset, 
+        int colOffset);
+
+int tile_fits_scalar(Board* board, Rotation* rotation, int rowOffset, 
+        int colOffset);
+
+#if defined(__AVX2__)
+int tile_fits_avx2(Board* board, Rotation* rotation, int rowOffset, 
+        int colOffset);
+#elif defined(__SSE2__)
+int tile_fits_sse2(Board* board, Rotation* rotation, int rowOffset, 
+        int colOffset);
+#endif
+
+void print_grid(Board* grid, Renderer* renderer);
+
+void render_row(Board* grid, int row, char* line);
+
+void free_renderer(Renderer* renderer);
 
 int check_load_errors(DataReadFlag statusObj);
 
@@ -104,9 +790,30 @@ FILE* open_file(char* tileName, DataReadFlag* loadFlag, char fileType);
 
 void check_tile_contents(DataReadFlag* loadFlag, int pos, int col, int row);
 
-void load_game(char* saveFileName, char*** grid, int* gameData, 
-        DataReadFlag* saveFlag, FILE** saveFile, int* numTiles, int* height,
-        int* width);
+void load_game(char* saveFileName, GameState* game, DataReadFlag* saveFlag,
+        FILE** saveFile);
+
+void read_save_header(FILE** saveFile, GameState* game, 
+        DataReadFlag* saveFlag);
+
+void load_mapped_game(char* data, size_t size, GameState* game, 
+        DataReadFlag* saveFlag);
+
+int load_row(Board* grid, int row, const char* cells);
+
+void load_binary_game(ByteSource* source, GameState* game, 
+        DataReadFlag* saveFlag);
+
+void unpack_board(ByteSource* source, Board* grid, DataReadFlag* saveFlag);
+
+void decode_runs(ByteSource* source, Board* grid, DataReadFlag* saveFlag);
+
+void fill_run(Board* grid, int row, int col, int length, int code);
+
+unsigned char* read_bytes(ByteSource* source, size_t count);
+
+void stamp_cells(Board* grid, int row, int col, uint64_t stars, 
+        uint64_t hashes);
 
 int check_tile_end(FILE** tileFile);
 
@@ -124,25 +831,42 @@ void set_invalid_save(DataReadFlag* saveFlag);
 
 int check_grid_point(int c);
 
-void load_grid(char*** grid, int height, int width, DataReadFlag* saveFlag,
+void load_grid(Board* grid, int height, int width, DataReadFlag* saveFlag,
         FILE** saveFile);
 
-void main_game_loop(char*** grid, Tile** tiles, int* gameData, int* height,
-        int* width, int* numTiles, Player* playerOne, Player* playerTwo,
-        DataReadFlag* fitzFlag);
+void new_game(GameState* game, Tile** tiles, int numTiles, 
+        Player* playerOne, Player* playerTwo, int render);
+
+Player* main_game_loop(GameState* game);
+
+int parse_options(int argc, char** argv, Options* options, 
+        DataReadFlag* optionFlag);
+
+int save_format(char* name);
+
+int run_batch(int argc, char** argv, Options* options);
+
+void run_batch_games(BatchRun* run, int threads);
+
+void* batch_worker(void* arg);
+
+void print_batch_results(BatchRun* run);
+
+double elapsed_seconds(struct timespec* start);
 
-void make_move(Tile* tile, Player* player, char*** grid, int height, 
-        int width, DataReadFlag* gameFlag, int* lastRow, int* lastCol, 
-        GameState* currentGameData);
+void flush_stats(void);
+
+void print_stats(void);
+
+int make_move(GameState* game, Player* player);
 
 void print_tile(Tile* tile);
 
 
-int check_user_input(int* row, int* col, DataReadFlag* readFlag, 
-        int* rotateAngle, GameState* currentGameState);
+int check_user_input(int* row, int* col, int* rotateAngle, 
+        GameState* game);
 
-int read_stdin(char** userInput, DataReadFlag* readFlag, 
-        GameState* currentGameState); 
+int read_stdin(char** userInput, GameState* game); 
 
 int validate_inputs(int* row, int* col, int* rotateAngle, char** userInput);
 
@@ -150,45 +874,199 @@ void clear_stdin(void);
 
 int clean_inputs(char** userInput);
 
-int attempt_place(int row, int col, Tile tile, char*** grid, int height,
-        int width, Player* player);
+int attempt_place(int row, int col, Rotation* rotation, Board* grid, 
+        Player* player);
+
+int can_place(int row, int col, Rotation* rotation, Board* grid);
 
-int check_game_over(char*** grid, int height, int width, Tile* tile);
+void commit_place(int row, int col, Rotation* rotation, Board* grid, 
+        Player* player);
+
+int check_game_over(Board* grid, Tile* tile);
 
-void free_grid(char*** grid, int height);
+void free_grid(Board* grid);
 
-int auto_play_one(Player* player, int rStart, int cStart, int height, 
-        int width, Tile* tile, char*** grid, int* row, int* col);
+int auto_play_one(Player* player, int rStart, int cStart, Tile* tile, 
+        Board* grid, SearchPool* pool, Placement* move);
 
 void game_over(Player* player);
 
 void allocate_start_coords(Player* player, int height, int width);
 
-int auto_play_two(Player* player, int height, int width, char*** grid, 
-        Tile* tile);
+int auto_play_two(Player* player, Board* grid, Tile* tile, 
+        SearchPool* pool, Placement* move);
+
+int auto_play_three(Player* player, Board* grid, Tile* tile, Tile* nextTile,
+        Arena* scratch, Placement* move);
+
+int choose_greedy_move(Board* grid, Tile* tile, Tile* nextTile, 
+        Arena* scratch, Placement* move);
+
+long count_replies(Board* grid, Shape* shape, unsigned char* legal, 
+        long stride);
+
+int overlap_offsets(Rotation* placed, Rotation* reply, long stride, 
+        long* offsets);
+
+int auto_play_four(Player* player, GameState* game, Placement* move);
+
+void init_search(Search* search, GameState* game);
+
+void free_search(Search* search);
+
+int choose_search_move(Search* search, Placement* move);
+
+int search_node(Search* search, int depth, int alpha, int beta, int ply);
+
+void search_move(Search* search, SearchNode* node, Tile* tile, int rotation,
+        int row, int col);
+
+void make_search_move(Search* search, Rotation* rotation, int row, int col,
+        Player* player);
+
+void unmake_search_move(Search* search, Rotation* rotation, int row, 
+        int col, Player* player);
+
+uint64_t placement_key(Board* board, Rotation* rotation, int row, int col);
+
+uint64_t zobrist_key(uint64_t number);
+
+int encode_search_move(Board* board, int rotation, int row, int col);
+
+int decode_search_move(Board* board, int number, int* row, int* col);
+
+long count_placements(Board* grid, Shape* shape);
+
+void fit_row(Board* grid, Rotation* rotation, int rowOffset, 
+        uint64_t* fits);
+
+uint64_t fit_word(Board* grid, Rotation* rotation, int rowOffset, int word);
+
+int auto_play_five(Player* player, GameState* game, Placement* move);
+
+int choose_mcts_move(GameState* game, Placement* move, long* playouts,
+        double* seconds);
+
+long root_visits(Mcts* trees, int count, int number);
+
+void init_mcts(Mcts* tree, GameState* game, struct timespec* start);
+
+void grow_trees(SearchPool* pool);
+
+void grow_tree(Mcts* tree);
+
+void mcts_playout(Mcts* tree);
+
+void expand_mcts_node(Mcts* tree, int node, int ply);
+
+void sample_move(Mcts* tree, int* moves, long seen, int number);
+
+int select_mcts_child(Mcts* tree, int node);
+
+int rollout(Mcts* tree, int ply);
+
+int random_position(Mcts* tree, int size);
+
+uint64_t next_random(uint64_t* state);
+
+void init_scan_order(ScanOrder* order, Board* grid, Tile* tile, 
+        int startRow, int startCol, int direction);
+
+void scan_step(ScanOrder* order, long step, Placement* move);
+
+long scan_steps(ScanOrder* order, long from, long to);
+
+int scan_fits(ScanOrder* order, long step);
+
+long scan_positions(ScanOrder* order, long first, long count, 
+        int angleFrom, int angleTo, int* angleIndex);
+
+uint64_t candidate_word(Board* grid, Rotation* rotation, int row, int word);
+
+int parallel_search(ScanOrder* order, SearchPool* pool, Player* player,
+        Placement* move);
+
+SearchPool* create_search_pool(int threads);
+
+void free_search_pool(SearchPool* pool);
+
+void* search_worker(void* arg);
+
+void search_blocks(SearchPool* pool);
+
+void run_pool(SearchPool* pool);
 
-void auto_two_move(Player* player, int height, int width, 
-        int* currentRow, int* currentCol);
 
 void print_auto_move(int currentRow, int currentCol, int currentAngle, 
         Player* player);
 
-void collect_game_data(GameState* currentGameData, int tileIndex, 
-        int playerNum, int height, int width, char*** grid);
+void attempt_save(GameState* game, char** userInput); 
+
+void save_binary(GameState* game, FILE* saveFile, int encoding);
+
+unsigned char* pack_board(Board* grid, unsigned char* out);
+
+unsigned char* encode_runs(Board* grid, unsigned char* out);
+
+unsigned char* put_run(unsigned char* out, int code, long length);
+
+uint64_t row_cells(Board* grid, int plane, int row, int col);
 
-void attempt_save(GameState* currentGameState, char** userInput); 
+unsigned int spread_bits(unsigned int bits);
+
+unsigned int gather_bits(unsigned int bits);
+
+uint32_t checksum(uint32_t hash, const unsigned char* data, size_t size);
 
 void update_last_play(int* lastRow, int* lastCol, int row, int col);
 
+void next_turn(GameState* game);
+
+void start_journal(char* fileName, GameState* game, DataReadFlag* flag);
+
+void journal_move(GameState* game, Player* player, Placement* move);
+
+void resume_journal(char* fileName, GameState* game, DataReadFlag* flag);
+
+void replay_move(GameState* game, unsigned char* record, 
+        DataReadFlag* flag);
+
+void read_journal_start(FILE* journal, ByteSource* source, GameState* game,
+        DataReadFlag* flag);
+
+Rotation* check_record(GameState* game, unsigned char* record, 
+        Placement* move, DataReadFlag* flag);
+
+int run_replay(int argc, char** argv);
+
+void load_replay(char* fileName, Replay* replay, DataReadFlag* flag);
+
+void replay_to(Replay* replay, long position);
+
+void undo_place(int row, int col, Rotation* rotation, Board* grid, 
+        Player* player);
+
+#ifndef FITZ_BENCH
 int main(int argc, char** argv) {
 
     FILE* tileFile = NULL; 
-    Tile** tiles;
-    char** grid;
-    int* gameData = (int*) calloc(2, sizeof(int)); //Holder for next tile/move
+    Tile** tiles = NULL;
     int width = 0, height = 0, numTiles = 0;
     Player* playerOne = NULL, *playerTwo = NULL; 
     DataReadFlag fitzFlag = {0};
+    GameState game;
+    Options options;
+    int optionArgs = parse_options(argc, argv, &options, &fitzFlag);
+    argc -= optionArgs; //Skip past the options, leaving argv[0] unused
+    argv += optionArgs;
+
+    if (argc >= 2 && !strcmp(argv[1], BATCH_FLAG)) {
+        return run_batch(argc, argv, &options);
+    }
+
+    if (argc >= 2 && !strcmp(argv[1], REPLAY_FLAG)) {
+        return run_replay(argc, argv);
+    }
 
     if (argc >= 2 && argc < 7 && argc != 3 && argc != 4) { //Valid # args
         tiles = load_tiles(&tileFile, &fitzFlag, argv[1], &numTiles);
@@ -197,6 +1075,13 @@ int main(int argc, char** argv) {
     if (argc == 5 || argc == 6) { //Arg values that require players
         playerOne = create_player(argv[2], playerOne, &fitzFlag, 1);
         playerTwo = create_player(argv[3], playerTwo, &fitzFlag, 2);
+        new_game(&game, tiles, numTiles, playerOne, playerTwo, 1);
+        game.renderer.diff = options.diffRender;
+        game.saveFormat = options.saveFormat;
+        game.searchTime = options.searchTime;
+        game.playouts = options.playouts;
+        game.prefixCounts = options.prefixCounts;
+        game.stats = options.stats;
     }
 
     switch (argc) { 
@@ -204,12 +1089,11 @@ int main(int argc, char** argv) {
             print_rotations(tiles, numTiles);
             return 0;
         case 5:
-            load_game(argv[4], &grid, gameData, &fitzFlag, &tileFile, 
-                    &numTiles, &height, &width);
+            load_game(argv[4], &game, &fitzFlag, &tileFile);
             break;
         case 6:
             check_parameters(argv[4], argv[5], &height, &width, &fitzFlag);
-            create_new_grid(height, width, &grid);
+            create_arena_grid(height, width, &(game.grid), &(game.arena));
             break;
 
         default:
@@ -217,96 +1101,424 @@ int main(int argc, char** argv) {
             check_load_errors(fitzFlag); //Will exit the program
     }
 
-    main_game_loop(&grid, tiles, gameData, &height, &width, &numTiles,
-            playerOne, playerTwo, &fitzFlag);
+    if (options.journalFile != NULL) {
+        start_journal(options.journalFile, &game, &fitzFlag);
+    }
+
+    game.pool = create_search_pool(options.searchThreads);
+    Player* loser = main_game_loop(&game);
+    free_search_pool(game.pool);
+    free_renderer(&(game.renderer));
+    arena_free(&(game.arena));
+    if (game.journal != NULL) {
+        fclose(game.journal);
+    }
+    if (options.stats) { //Before either way out of the game
+        print_stats();
+    }
+    check_load_errors(game.flag); //Exits if the game was cut short
+    game_over(loser);
     return 0;
 }
+#endif
 
 /*
- * Takes a pointer to a player struct, the dimensions of the current game 
- * board, and assigns initial "last play" values dependent on player type as 
- * per the specification for automatic players. Returns nothing, no error 
- * conditions.
+ * Option parsing function. Takes the commandline arguments, an options 
+ * struct to fill, and a status flag struct. Reads any options given ahead
+ * of the usual arguments:
+ *      --search-threads n   split automatic player searches over n threads
+ *      --diff-render        print only the board rows changed each turn
+ *      --save-format f      save games as text (the default), binary or 
+ *                           rle (binary with run length coded boards)
+ *      --journal file       append every move played to a new journal 
+ *      --search-time ms     let type 4 and 5 players search for ms 
+ *                           milliseconds a move (100 unless given)
+ *      --playouts n         stop type 5 players' searches after n playouts
+ *      --prefix-counts      keep running counts of each board row's 
+ *                           occupied cells, to turn down moves quickly
+ *      --stats              print how much work the hot paths did to 
+ *                           stderr once the game (or batch) is over
+ * Returns the number of arguments used up by options. Exits fitz with the
+ * usage message if an option is unknown or has an invalid value.
  */
-void allocate_start_coords(Player* player, int height, int width) {
-    if (player->type == '2') {
-        if (player->playerNum == 1) { //First player starts in
-            player->lastRow = -2; //Top corner
-            player->lastCol = -2;
-        } else { //Second player (type 2) starts in bottom right
-            player->lastRow = height + 2;
-            player->lastCol = width + 2;
+int parse_options(int argc, char** argv, Options* options, 
+        DataReadFlag* optionFlag) {
+    int index = 1;
+    options->searchThreads = 1;
+    options->diffRender = 0;
+    options->saveFormat = TEXT_SAVE;
+    options->journalFile = NULL;
+    options->searchTime = SEARCH_TIME_MS;
+    options->playouts = 0;
+    options->prefixCounts = 0;
+    options->stats = 0;
+
+    while (index < argc && !strncmp(argv[index], "--", 2) && 
+            strcmp(argv[index], BATCH_FLAG) && 
+            strcmp(argv[index], REPLAY_FLAG)) {
+        if (!strcmp(argv[index], SEARCH_THREADS_FLAG) && index + 1 < argc) {
+            options->searchThreads = atoi(argv[index + 1]);
+            index += 2;
+        } else if (!strcmp(argv[index], DIFF_RENDER_FLAG)) {
+            options->diffRender = 1;
+            index++;
+        } else if (!strcmp(argv[index], PREFIX_COUNTS_FLAG)) {
+            options->prefixCounts = 1;
+            index++;
+        } else if (!strcmp(argv[index], STATS_FLAG)) {
+            options->stats = 1;
+            index++;
+        } else if (!strcmp(argv[index], SAVE_FORMAT_FLAG) && 
+                index + 1 < argc) {
+            options->saveFormat = save_format(argv[index + 1]);
+            index += 2;
+        } else if (!strcmp(argv[index], JOURNAL_FLAG) && index + 1 < argc) {
+            options->journalFile = argv[index + 1];
+            index += 2;
+        } else if (!strcmp(argv[index], SEARCH_TIME_FLAG) && 
+                index + 1 < argc) {
+            options->searchTime = atoi(argv[index + 1]);
+            index += 2;
+        } else if (!strcmp(argv[index], PLAYOUTS_FLAG) && index + 1 < argc) {
+            options->playouts = atol(argv[index + 1]);
+            index += 2;
+        } else {
+            options->searchThreads = 0; //Unknown option
+        }
+
+        if (options->searchThreads < 1 || options->saveFormat < 0 || 
+                options->searchTime < 1 || options->playouts < 0) {
+            optionFlag->returnVal = INVALID_ARGS;
+            check_load_errors(*optionFlag);
         }
     }
+    return index - 1;
 }
 
-/* 
- * Main game loop for fitz; takes a game board, a set of tiles, current game 
- * data, the dimensions of the game board (height and width), the number of
- * tiles inside the set of tiles, both players, and a status flag struct. 
- * Begins playing a game of fitz using this data.
- */
-void main_game_loop(char*** grid, Tile** tiles, int* gameData, int* height,
-        int* width, int* numTiles, Player* playerOne, Player* playerTwo,
-        DataReadFlag* fitzFlag) {
-    
-    int lastRow = -2; //Default global positions for player type 1;
-    int lastCol = -2;
-    allocate_start_coords(playerOne, *height, *width);
-    allocate_start_coords(playerTwo, *height, *width);
-    GameState currentGameData;   
-
-    while (1) {
-        collect_game_data(&currentGameData, gameData[0], gameData[1], *height, 
-                *width, grid);
+/*
+ * Takes the name of a save format given on the commandline and returns 
+ * that format, or -1 if there is no such format.
+ */
+int save_format(char* name) {
+    if (!strcmp(name, "text")) {
+        return TEXT_SAVE;
+    } else if (!strcmp(name, "binary")) {
+        return BINARY_SAVE;
+    } else if (!strcmp(name, "rle")) {
+        return RLE_SAVE;
+    }
+    return -1;
+}
 
-        if (gameData[1] == 0) { //Player one
-            make_move(tiles[gameData[0]], playerOne, grid, *height, *width,
-                    fitzFlag, &lastRow, &lastCol, &currentGameData);
+/*
+ * Game setup function. Takes an uninitialised game, the tiles to be played
+ * and the number of tiles, both players, and whether the game should be 
+ * printed as it is played. Sets the game up to start from the first tile 
+ * with player one to move. The board is left for the caller to create or 
+ * load. The tiles are shared and only ever read during play.
+ */
+void new_game(GameState* game, Tile** tiles, int numTiles, 
+        Player* playerOne, Player* playerTwo, int render) {
+    game->tiles = tiles;
+    game->numTiles = numTiles;
+    game->players[0] = *playerOne;
+    game->players[1] = *playerTwo;
+    game->currentTile = 0;
+    game->currentPlayer = 0;
+    game->lastRow = -2; //Default global positions for player type 1;
+    game->lastCol = -2;
+    game->flag.returnVal = 0;
+    game->render = render;
+    game->renderer.frame = game->renderer.output = NULL;
+    game->renderer.diff = game->renderer.drawn = 0;
+    game->saveFormat = TEXT_SAVE;
+    game->journal = NULL;
+    game->moveCount = 0;
+    game->pool = NULL;
+    game->searchTime = SEARCH_TIME_MS;
+    game->playouts = 0;
+    arena_init(&(game->arena));
+    game->input = NULL;
+    game->prefixCounts = 0;
+    game->stats = 0;
+}
 
-        } else {
-            make_move(tiles[gameData[0]], playerTwo, grid, *height, *width,
-                    fitzFlag, &lastRow, &lastCol, &currentGameData);
-        }
-    
-        gameData[1] = !gameData[1]; //Change our player 
+/*
+ * Batch simulation function. Takes the commandline arguments of a batch 
+ * run: fitz --batch tilefile p1type p2type minsize maxsize games [threads]
+ * and any options given ahead of them.
+ * Plays the given number of automatic games without printing any boards,
+ * game i being played on a square board of size 
+ * minsize + i % (maxsize - minsize + 1). Games are shared out between 
+ * a pool of threads (one per online core unless given). Prints one CSV 
+ * line per game, in game order, with its board size, winner, number of 
+ * moves, wall time and the number of heap allocations made for it.
+ * Exits fitz on invalid arguments, else returns 0.
+ */
+int run_batch(int argc, char** argv, Options* options) {
+    DataReadFlag batchFlag = {0};
+    FILE* tileFile = NULL;
+    BatchRun run;
+    int unused = 0;
+    int valid = (argc == BATCH_ARGS || argc == BATCH_ARGS + 1);
+    int threads = (argc == BATCH_ARGS + 1) ? atoi(argv[8]) : 
+            (int) sysconf(_SC_NPROCESSORS_ONLN);
+    Player* playerOne = NULL, *playerTwo = NULL;
+
+    run.games = valid ? atoi(argv[7]) : 0;
+    if (!valid || run.games < 1 || threads < 1) {
+        batchFlag.returnVal = INVALID_BATCH_ARGS;
+        check_load_errors(batchFlag);
+    }
+    run.tiles = load_tiles(&tileFile, &batchFlag, argv[2], &(run.numTiles));
+    playerOne = create_player(argv[3], playerOne, &batchFlag, 1);
+    playerTwo = create_player(argv[4], playerTwo, &batchFlag, 2);
+    if (playerOne->type == 'h' || playerTwo->type == 'h') {
+        batchFlag.returnVal = INVALID_PLAYER; //Nobody to type the moves
+        check_load_errors(batchFlag);
+    }
+    check_parameters(argv[5], argv[5], &(run.minSize), &unused, &batchFlag);
+    check_parameters(argv[6], argv[6], &(run.maxSize), &unused, &batchFlag);
+    if (run.minSize > run.maxSize) {
+        batchFlag.returnVal = INVALID_BOARD_PARAM;
+        check_load_errors(batchFlag);
+    }
 
-        if (gameData[0] == (*numTiles - 1)) { //-1 for indexing, resets index
-            gameData[0] = 0;
-        } else {
-            gameData[0]++;
+    run.playerOne = *playerOne;
+    run.playerTwo = *playerTwo;
+    run.options = *options;
+    printf("game,height,width,winner,moves,seconds,allocations\n");
+    run_batch_games(&run, (threads < run.games) ? threads : run.games);
+    if (options->stats) { //Totals over every game of the run
+        print_stats();
+    }
+    return 0;
+}
+
+/*
+ * Thread pool function. Takes a set up batch run and a number of threads,
+ * and plays every game of the run across that many worker threads, 
+ * returning once all games have finished and been printed.
+ */
+void run_batch_games(BatchRun* run, int threads) {
+    pthread_t* workers = (pthread_t*) malloc(sizeof(pthread_t) * threads);
+    run->results = (BatchResult*) calloc(run->games, sizeof(BatchResult));
+    run->nextGame = 0;
+    run->nextPrint = 0;
+    pthread_mutex_init(&(run->lock), NULL);
+
+    for (int i = 0; i < threads; i++) {
+        pthread_create(&workers[i], NULL, batch_worker, run);
+    }
+    for (int i = 0; i < threads; i++) {
+        pthread_join(workers[i], NULL);
+    }
+
+    pthread_mutex_destroy(&(run->lock));
+    free(run->results);
+    free(workers);
+}
+
+/*
+ * Thread pool worker. Takes a batch run (as a void pointer for 
+ * pthread_create) and keeps claiming and playing the next unplayed game
+ * of the run until there are none left. Each game is played on the
+ * worker's own game state (and search pool); only the tiles are shared. 
+ * The worker's games share one arena, reset between games, so once it 
+ * has grown to fit the largest game played no more heap allocations are
+ * made. Returns NULL.
+ */
+void* batch_worker(void* arg) {
+    BatchRun* run = (BatchRun*) arg;
+    SearchPool* pool = create_search_pool(run->options.searchThreads);
+    Arena arena;
+    arena_init(&arena);
+
+    while (1) {
+        pthread_mutex_lock(&(run->lock));
+        int gameNum = run->nextGame++;
+        pthread_mutex_unlock(&(run->lock));
+        if (gameNum >= run->games) {
+            free_search_pool(pool);
+            arena_free(&arena);
+            flush_stats();
+            return NULL;
         }
 
-        free_grid(&(currentGameData.grid), *height); //Free old save state
+        int size = run->minSize + gameNum % (run->maxSize - run->minSize + 1);
+        BatchResult* result = &(run->results[gameNum]);
+        struct timespec start;
+        GameState game;
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        new_game(&game, run->tiles, run->numTiles, &(run->playerOne), 
+                &(run->playerTwo), 0);
+        game.arena = arena; //Hand the worker's arena to this game
+        create_arena_grid(size, size, &(game.grid), &(game.arena));
+        game.pool = pool;
+        game.searchTime = run->options.searchTime;
+        game.playouts = run->options.playouts;
+        game.prefixCounts = run->options.prefixCounts;
+        Player* loser = main_game_loop(&game);
+        result->seconds = elapsed_seconds(&start);
+        result->height = result->width = size;
+        result->winner = (loser->playerNum == 1) ? '#' : '*';
+        result->moves = game.moveCount;
+        result->allocations = game.arena.heapAllocations - 
+                arena.heapAllocations;
+        free_grid(&(game.grid));
+        arena = game.arena; //Take it back for the next game
+        arena_reset(&arena);
+
+        pthread_mutex_lock(&(run->lock));
+        result->done = 1;
+        print_batch_results(run);
+        pthread_mutex_unlock(&(run->lock));
     }
 }
 
 /*
- * Collection function to create game save state.
- * Takes a GameState struct, current index of tile to be played,
- * the current players number, the height and width of the game board,
- * as well as the gameboard itself and stores 
- * this data inside the GameState struct for future use.
+ * Printing function. Takes a batch run (with its lock held) and prints 
+ * every finished game not yet printed as a CSV line to stdout, stopping 
+ * at the first unfinished game so lines come out in game order.
  */
-void collect_game_data(GameState* currentGameData, int tileIndex, 
-        int playerNum, int height, int width, char*** grid) {
-    currentGameData->currentTile = tileIndex;
-    currentGameData->currentPlayer = playerNum;
-    currentGameData->gridHeight = height;
-    currentGameData->gridWidth = width;
-    create_new_grid(height, width, &(currentGameData->grid));
-    
-    //Populate created grid with current gameboard data
-    for (int i = 0; i < height; i++) {
-        for (int j = 0; j < width; j++) {
-            currentGameData->grid[i][j] = (*grid)[i][j];
+void print_batch_results(BatchRun* run) {
+    while (run->nextPrint < run->games && 
+            run->results[run->nextPrint].done) {
+        BatchResult* result = &(run->results[run->nextPrint]);
+        printf("%d,%d,%d,%c,%ld,%.6f,%ld\n", run->nextPrint, 
+                result->height, result->width, result->winner, 
+                result->moves, result->seconds, result->allocations);
+        run->nextPrint++;
+    }
+    fflush(stdout);
+}
+
+/*
+ * Timing function. Takes a start time read from CLOCK_MONOTONIC and returns
+ * the number of seconds elapsed since.
+ */
+double elapsed_seconds(struct timespec* start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double) (now.tv_sec - start->tv_sec) + 
+            (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/*
+ * Stats function. Adds the calling thread's hot path counters to the 
+ * process's totals and zeroes them, so work done on search and batch
+ * threads is in the report. Threads call this before going idle.
+ */
+void flush_stats(void) {
+#ifndef NO_STATS
+    long* from = (long*) &threadStats;
+    long* to = (long*) &totalStats;
+    pthread_mutex_lock(&statsLock);
+    for (size_t i = 0; i < sizeof(Stats) / sizeof(long); i++) {
+        to[i] += from[i];
+        from[i] = 0;
+    }
+    pthread_mutex_unlock(&statsLock);
+#endif
+}
+
+/*
+ * Stats function. Prints the hot path counters of every game played so 
+ * far to stderr, keeping stdout to the game itself.
+ */
+void print_stats(void) {
+#ifndef NO_STATS
+    Stats* stats = &totalStats;
+    flush_stats();
+    fprintf(stderr, "placement probes  %ld (%ld off the board, %ld by "
+            "prefix counts, %ld collisions)\n", stats->probes, 
+            stats->outOfBounds, stats->prefixRejects, stats->collisions);
+    fprintf(stderr, "word checks       %ld\n", stats->wordChecks);
+    fprintf(stderr, "search nodes      %ld\n", stats->searchNodes);
+    fprintf(stderr, "mcts playouts     %ld\n", stats->mctsPlayouts);
+    fprintf(stderr, "index checks      %ld\n", stats->indexChecks);
+    fprintf(stderr, "tile rotations    %ld\n", stats->rotations);
+    fprintf(stderr, "game over checks  %ld (%ld scans visiting %ld "
+            "points)\n", stats->gameOverChecks, stats->gameOverScans, 
+            stats->cellsVisited);
+    fprintf(stderr, "boards allocated  %ld\n", stats->grids);
+    fprintf(stderr, "bytes printed     %ld\n", stats->printBytes);
+    fprintf(stderr, "bytes saved       %ld\n", stats->saveBytes);
+#else
+    fprintf(stderr, "fitz was built without stats (NO_STATS)\n");
+#endif
+}
+
+/*
+ * Takes a pointer to a player struct, the dimensions of the current game 
+ * board, and assigns initial "last play" values dependent on player type as 
+ * per the specification for automatic players. Returns nothing, no error 
+ * conditions.
+ */
+void allocate_start_coords(Player* player, int height, int width) {
+    if (player->type == '2') {
+        if (player->playerNum == 1) { //First player starts in
+            player->lastRow = -2; //Top corner
+            player->lastCol = -2;
+        } else { //Second player (type 2) starts in bottom right
+            player->lastRow = height + 2;
+            player->lastCol = width + 2;
+        }
+    }
+}
+
+/* 
+ * Main game loop for fitz; takes a set up game with its board in place,
+ * and plays it until a player is left without a valid move, returning 
+ * that player. Returns NULL instead if the game was cut short, with the 
+ * reason left in the game's status flag. Never exits fitz.
+ */
+Player* main_game_loop(GameState* game) {
+    Player* playerOne = &(game->players[0]);
+    Player* playerTwo = &(game->players[1]);
+    if (game->moveCount == 0) { //Resumed games carry on from their moves
+        allocate_start_coords(playerOne, game->grid.height, 
+                game->grid.width);
+        allocate_start_coords(playerTwo, game->grid.height, 
+                game->grid.width);
+    }
+    build_move_index(&(game->grid), game->tiles, game->numTiles);
+    if (game->prefixCounts) {
+        build_prefix_counts(&(game->grid));
+    }
+
+    while (1) {
+        Player* player = (game->currentPlayer == 0) ? playerOne : playerTwo;
+
+        if (!make_move(game, player)) {
+            //No valid move left for this player, or the input ran out
+            return (game->flag.returnVal != 0) ? NULL : player;
         }
+        next_turn(game);
+    }
+}
+
+/*
+ * Takes a game in which a move has just been played, and counts the move
+ * and hands the next tile over to the next player.
+ */
+void next_turn(GameState* game) {
+    game->moveCount++;
+
+    game->currentPlayer = !game->currentPlayer; //Change our player 
+
+    if (game->currentTile == (game->numTiles - 1)) { //-1 for indexing
+        game->currentTile = 0; //Resets index
+    } else {
+        game->currentTile++;
     }
 }
 
 /*
- * Game over function. Takes a player and prints a gameover message declaring
- * the opposite player the winner, then exits fitz.
+ * Game over function. Takes the player left without a move and prints a 
+ * gameover message declaring the opposite player the winner, then exits 
+ * fitz.
  */
 void game_over(Player* player) {
     printf("Player %c wins\n", (player->playerNum == 1) ? '#' : '*');
@@ -314,28 +1526,29 @@ void game_over(Player* player) {
 }
 
 /*
- * Move function which takes the current tile to be played, 
- * the player making the move, the current game board,
- * the height and width of the board, a status flag struct,
- * the last played legal move (row and column values), and
- * a GameState struct for saving. 
+ * Move function which takes the current game and the player making the 
+ * move, and plays the current tile for that player.
  *
  * Checks for any valid moves
  * on board before prompting players for input; switching
  * behaviour based on the current players type as per the
- * specificaiton.
+ * specificaiton. Returns 0 if the player has no valid move (game over),
+ * or if a human player's input ran out (flagged in the game's status), 
+ * 1 otherwise.
  */
-void make_move(Tile* tile, Player* player, char*** grid, int height, 
-        int width, DataReadFlag* gameFlag, int* lastRow, int* lastCol, 
-        GameState* currentGameData) {
-        
+int make_move(GameState* game, Player* player) {
+    Tile* tile = game->tiles[game->currentTile];
+    Board* grid = &(game->grid);
     int col = 0, row = 0, readMove = 1, valid = 0; //Placement vals
-    int rotateAngle = 0; 
+    int rotateAngle = 0, placed = 0; 
+    Placement move;
 
-    print_grid(height, width, *grid);
+    if (game->render) {
+        print_grid(grid, &(game->renderer));
+    }
 
-    if (!check_game_over(grid, height, width, tile)) { 
-        game_over(player);
+    if (!check_game_over(grid, tile)) { 
+        return 0;
     }
 
     switch (player->type) {
@@ -343,13 +1556,16 @@ void make_move(Tile* tile, Player* player, char*** grid, int height,
             print_tile(tile);
             while (readMove) {
                 printf("Player %c] ", player->icon);
-                valid = check_user_input(&row, &col, gameFlag, &rotateAngle, 
-                        currentGameData);
+                valid = check_user_input(&row, &col, &rotateAngle, game);
+                if (game->flag.returnVal != 0) {
+                    return 0; //Input ran out
+                }
                 if (valid) { //If valid user input for move, try to play
-                    Tile playTile = rotate_tile(tile, 
-                            (rotateAngle / ROTATION_STEP));
-                    if (attempt_place(row, col, playTile, grid, height, width,
-                            player)) {
+                    if (attempt_place(row, col, 
+                            tile_rotation(tile, rotateAngle), grid, player)) {
+                        move.row = row;
+                        move.col = col;
+                        move.angle = rotateAngle;
                         readMove = 0; //End loop 
                     } else {
                         continue;
@@ -360,18 +1576,43 @@ void make_move(Tile* tile, Player* player, char*** grid, int height,
             }
             break;
 
-        case '1': 
-            auto_play_one(player, *lastRow, *lastCol, height, width, tile, 
-                    grid, &row, &col);
+        case '1': //Leaves row and col at 0 for the next type 1 search
+            placed = auto_play_one(player, game->lastRow, game->lastCol, 
+                    tile, grid, game->pool, &move);
             break;
         case '2': 
-            auto_play_two(player, height, width, grid, tile);
+            placed = auto_play_two(player, grid, tile, game->pool, &move);
             row = player->lastRow; //Update these so type 1's can make move
             col = player->lastCol; //Grabs the updated play from player
             break;
+        case '3':
+            placed = auto_play_three(player, grid, tile, 
+                    game->tiles[(game->currentTile + 1) % game->numTiles],
+                    &(game->arena), &move);
+            row = player->lastRow;
+            col = player->lastCol;
+            break;
+        case '4':
+            placed = auto_play_four(player, game, &move);
+            row = player->lastRow;
+            col = player->lastCol;
+            break;
+        case '5':
+            placed = auto_play_five(player, game, &move);
+            row = player->lastRow;
+            col = player->lastCol;
+            break;
+    }
+
+    if (placed && game->render) {
+        print_auto_move(move.row, move.col, move.angle, player);
     }
     
-    update_last_play(lastRow, lastCol, row, col);
+    update_last_play(&(game->lastRow), &(game->lastCol), row, col);
+    if (game->journal != NULL) {
+        journal_move(game, player, &move);
+    }
+    return 1;
 }
 
 /*
@@ -385,81 +1626,352 @@ void update_last_play(int* lastRow, int* lastCol, int row, int col) {
 }
 
 /*
- * Automatic player algorithm type 2. Takes the player of type 2, the 
- * height and width of the game board, the game board itself,
- * and the current tile to be played, and begins searching for
- * a valid move as per the algorithm in spec. 
- * Returns 1 upon finding a valid move and making it; 0 otherwise.
+ * Journal function. Takes the path of a journal to start, a game ready to
+ * be played and a status flag struct. Writes the magic "FJNL" and journal
+ * version (1) followed by a run length coded binary save of the game as 
+ * it stands, after which make_move appends each move played. Any journal
+ * the game was already writing is closed. Exits fitz if the journal can't
+ * be created.
  */
-int auto_play_two(Player* player, int height, int width, char*** grid, 
-        Tile* tile) {
-    int currentRow = player->lastRow;
-    int currentCol = player->lastCol;
-    int searching = 1, tileDone = 0, currentAngle = 0;
-
-    while (searching) {
-        if (attempt_place(currentRow, currentCol, rotate_tile(tile, 
-                currentAngle / ROTATION_STEP), grid, height, width, player)) {
-            player->lastRow = currentRow;
-            player->lastCol = currentCol; //Update with the last valid pos
-            print_auto_move(currentRow, currentCol, currentAngle, player);
-            return 1; 
-        } else {
-            currentAngle += ROTATION_STEP;
-            if (currentAngle <= MAX_ANGLE) {
-                continue;
-            } else {
-                currentAngle = 0;
-                tileDone = 1; 
-            }
+void start_journal(char* fileName, GameState* game, DataReadFlag* flag) {
+    unsigned char prefix[5] = {'F', 'J', 'N', 'L', JOURNAL_VERSION};
+    if (game->journal != NULL) {
+        fclose(game->journal);
+    }
+
+    game->journal = fopen(fileName, "w");
+    if (game->journal == NULL) {
+        flag->returnVal = INVALID_SAVE_FILE;
+        check_load_errors(*flag);
+    }
+    fwrite(prefix, 1, sizeof(prefix), game->journal);
+    save_binary(game, game->journal, RLE_BOARD);
+    fflush(game->journal);
+}
+
+/*
+ * Journal function. Takes a journalled game, the player who just moved 
+ * and the move they played, and appends a record of it to the journal:
+ * player number (1 byte), tile index (4 bytes), row and column (2 bytes 
+ * each, signed) and the angle in quarter turns (1 byte), little endian.
+ * The record is flushed straight away so that it survives a crash.
+ */
+void journal_move(GameState* game, Player* player, Placement* move) {
+    unsigned char record[JOURNAL_RECORD];
+    record[0] = (unsigned char) player->playerNum;
+    for (int i = 0; i < 4; i++) {
+        record[1 + i] = (unsigned char) (game->currentTile >> (8 * i));
+    }
+    record[5] = (unsigned char) (move->row & 0xFF);
+    record[6] = (unsigned char) ((move->row >> 8) & 0xFF);
+    record[7] = (unsigned char) (move->col & 0xFF);
+    record[8] = (unsigned char) ((move->col >> 8) & 0xFF);
+    record[9] = (unsigned char) (move->angle / ROTATION_STEP);
+
+    fwrite(record, 1, JOURNAL_RECORD, game->journal);
+    fflush(game->journal);
+}
+
+/*
+ * Journal function. Takes the path of a journal (see start_journal), a 
+ * game set up with its tiles and players, and a status flag struct. Loads
+ * the saved game the journal starts from, then replays every whole move 
+ * record after it. A record cut short by a crash is dropped from the end
+ * of the journal, and the game carries on appending to it. Exits fitz if 
+ * the journal can't be opened for appending, or is invalid.
+ */
+void resume_journal(char* fileName, GameState* game, DataReadFlag* flag) {
+    ByteSource source;
+    FILE* journal = fopen(fileName, "r+");
+    if (journal == NULL) {
+        flag->returnVal = INVALID_SAVE_FILE;
+        check_load_errors(*flag);
+    }
+
+    read_journal_start(journal, &source, game, flag);
+    allocate_start_coords(&(game->players[0]), game->grid.height, 
+            game->grid.width);
+    allocate_start_coords(&(game->players[1]), game->grid.height, 
+            game->grid.width);
+
+    long end = ftell(journal);
+    unsigned char* record;
+    while ((record = read_bytes(&source, JOURNAL_RECORD)) != NULL) {
+        replay_move(game, record, flag);
+        end = ftell(journal);
+    }
+
+    fseek(journal, end, SEEK_SET); //Drop any partly written record
+    if (ftruncate(fileno(journal), end) != 0) {
+        set_invalid_save(flag);
+    }
+    game->journal = journal;
+}
+
+/*
+ * Journal function. Takes a game being resumed, a move record from its 
+ * journal (see journal_move) and a status flag struct. Checks the move is
+ * the next player's, with the next tile, and legal, then plays it, 
+ * leaving the game and its players as make_move would have. Exits fitz if
+ * the record is invalid.
+ */
+void replay_move(GameState* game, unsigned char* record, 
+        DataReadFlag* flag) {
+    Player* player = &(game->players[game->currentPlayer]);
+    Placement move;
+    Rotation* rotation = check_record(game, record, &move, flag);
+    int row = move.row, col = move.col;
+    commit_place(row, col, rotation, &(game->grid), player);
+
+    if (player->type != 'h' && player->type != '1') { //Last move kept
+        player->lastRow = row;
+        player->lastCol = col;
+    }
+    if (player->type == '1') { //Type 1 moves leave the last play at 0 0
+        row = col = 0;
+    }
+    update_last_play(&(game->lastRow), &(game->lastCol), row, col);
+    next_turn(game);
+}
+
+/*
+ * Journal function. Takes a journal opened at its start, a byte source to
+ * read it through, a game set up with its tiles and players, and a status
+ * flag struct. Checks the journal's magic and version and loads the saved
+ * game it starts from, leaving the source at the first move record. Exits
+ * fitz if the journal is invalid.
+ */
+void read_journal_start(FILE* journal, ByteSource* source, GameState* game,
+        DataReadFlag* flag) {
+    unsigned char prefix[5];
+    if (fread(prefix, 1, sizeof(prefix), journal) != sizeof(prefix) || 
+            memcmp(prefix, JOURNAL_MAGIC, 4) || 
+            prefix[4] != JOURNAL_VERSION) {
+        set_invalid_save(flag);
+    }
+
+    source->data = NULL;
+    source->file = journal;
+    source->hash = FNV_OFFSET;
+    load_binary_game(source, game, flag);
+}
+
+/*
+ * Journal function. Takes a game, a move record from its journal (see 
+ * journal_move), a placement to fill in and a status flag struct. Reads 
+ * the move into the placement and checks it is the next player's, with 
+ * the next tile, and legal on the game's board. Returns the rotation of 
+ * the tile played. Exits fitz if the record is invalid.
+ */
+Rotation* check_record(GameState* game, unsigned char* record, 
+        Placement* move, DataReadFlag* flag) {
+    uint32_t tile = 0;
+    for (int i = 0; i < 4; i++) {
+        tile |= (uint32_t) record[1 + i] << (8 * i);
+    }
+    move->row = (int16_t) (record[5] | (record[6] << 8));
+    move->col = (int16_t) (record[7] | (record[8] << 8));
+    move->angle = record[9] * ROTATION_STEP;
+
+    if (record[0] != game->currentPlayer + 1 || tile != 
+            (uint32_t) game->currentTile || record[9] >= ROTATION_COUNT) {
+        set_invalid_save(flag);
+    }
+    Rotation* rotation = tile_rotation(game->tiles[tile], move->angle);
+    if (!can_place(move->row, move->col, rotation, &(game->grid))) {
+        set_invalid_save(flag);
+    }
+    return rotation;
+}
+
+/*
+ * Replay function. Takes the commandline arguments of a replay: 
+ * fitz --replay tilefile journal
+ * Loads the game recorded in the journal (see start_journal) and reads 
+ * commands from stdin to move through it, without playing any moves of 
+ * its own. Before each command the number of moves played out of the 
+ * total is shown. Commands are:
+ *      goto n      go to the position after n moves (0 is the start)
+ *      next [n]    play the next move (or n moves)
+ *      back [n]    take back the last move (or n moves)
+ *      print       print the board
+ * Moves are played with attempt_place and taken back cell for cell, so 
+ * moving anywhere in the game costs only the moves passed over. Exits 
+ * fitz on invalid arguments or journal, else returns 0 at end of input.
+ */
+int run_replay(int argc, char** argv) {
+    DataReadFlag replayFlag = {0};
+    FILE* tileFile = NULL;
+    Player* playerOne = NULL, *playerTwo = NULL;
+    int numTiles = 0;
+    char line[MAX_INPUT + 2];
+    Replay replay;
+
+    if (argc != REPLAY_ARGS) {
+        replayFlag.returnVal = INVALID_REPLAY_ARGS;
+        check_load_errors(replayFlag);
+    }
+    Tile** tiles = load_tiles(&tileFile, &replayFlag, argv[2], &numTiles);
+    playerOne = create_player("h", playerOne, &replayFlag, 1);
+    playerTwo = create_player("h", playerTwo, &replayFlag, 2);
+    new_game(&(replay.game), tiles, numTiles, playerOne, playerTwo, 1);
+    load_replay(argv[3], &replay, &replayFlag);
+
+    while (1) {
+        long count = 1;
+        printf("Replay %ld/%ld] ", replay.position, replay.total);
+        if (fgets(line, sizeof(line), stdin) == NULL) {
+            printf("\n");
+            return 0;
         }
-        
-        if (tileDone) { //Move to next position in gameboard
-            tileDone = 0;
-            auto_two_move(player, height, width, &currentRow, &currentCol);
-                
-            if (currentRow == player->lastRow && 
-                    currentCol == player->lastCol) {
-                break; //Reached starting pos again
-            }
+
+        if (sscanf(line, "goto %ld", &count) == 1) {
+            replay_to(&replay, count);
+        } else if (!strncmp(line, "next", 4)) {
+            sscanf(line, "next %ld", &count);
+            replay_to(&replay, replay.position + count);
+        } else if (!strncmp(line, "back", 4)) {
+            sscanf(line, "back %ld", &count);
+            replay_to(&replay, replay.position - count);
+        } else if (!strncmp(line, "print", 5)) {
+            print_grid(&(replay.game.grid), &(replay.game.renderer));
         }
     }
-    return 0;
 }
 
 /*
- * Movement function for automatic player algorithm type 2. 
- * Takes the current player, the height and width of the 
- * gameboard, as well as the row and column used immediately
- * previous by the player algorithm. 
- *
- * Increments the next position for the player to try 
- * based on whether they are player one or two as per the
- * spec, moving player one from left->right, top->bottom
- * and vice versa for both for player two.
- */
-void auto_two_move(Player* player, int height, int width, 
-        int* currentRow, int* currentCol) {
-    if (player->playerNum == 1) {
-        *currentCol = *currentCol + 1; //Increments 
-        if (*currentCol > width + 2) {
-            *currentCol = -2;
-            *currentRow = *currentRow + 1;
-        }
-        if (*currentRow > height + 2) {
-            *currentRow = -2;
-        }
-    } else {
-        *currentCol = *currentCol - 1; //Decrements
-        if (*currentCol < -2) {
-            *currentCol = width + 2;
-            *currentRow = *currentRow - 1;
+ * Replay function. Takes the path of a journal, a replay with its game 
+ * set up, and a status flag struct. Loads the game the journal starts 
+ * from and checks and keeps every whole move recorded after it, leaving 
+ * the replay at the start of the game. Exits fitz if the journal can't be
+ * opened or is invalid.
+ */
+void load_replay(char* fileName, Replay* replay, DataReadFlag* flag) {
+    GameState* game = &(replay->game);
+    ByteSource source;
+    FILE* journal = fopen(fileName, "r");
+    if (journal == NULL) {
+        flag->returnVal = INVALID_SAVE_FILE;
+        check_load_errors(*flag);
+    }
+
+    read_journal_start(journal, &source, game, flag);
+    replay->startTile = game->currentTile;
+    replay->startPlayer = game->currentPlayer;
+    replay->total = 0;
+    long capacity = 1024;
+    replay->moves = (ReplayMove*) malloc(sizeof(ReplayMove) * capacity);
+
+    unsigned char* record;
+    while ((record = read_bytes(&source, JOURNAL_RECORD)) != NULL) {
+        Placement move;
+        ReplayMove* replayed = &(replay->moves[replay->total++]);
+        replayed->rotation = check_record(game, record, &move, flag);
+        replayed->row = move.row;
+        replayed->col = move.col;
+        commit_place(move.row, move.col, replayed->rotation, &(game->grid), 
+                &(game->players[game->currentPlayer]));
+        next_turn(game);
+
+        if (replay->total == capacity) {
+            capacity *= 2;
+            replay->moves = (ReplayMove*) realloc(replay->moves, 
+                    sizeof(ReplayMove) * capacity);
         }
+    }
+    fclose(journal);
+
+    replay->position = replay->total;
+    replay_to(replay, 0); //Moves were played to check them
+}
+
+/*
+ * Replay function. Takes a replay and a number of moves (kept within the
+ * game), and plays or takes back moves until that many have been played.
+ */
+void replay_to(Replay* replay, long position) {
+    GameState* game = &(replay->game);
+    position = (position < 0) ? 0 : position;
+    position = (position > replay->total) ? replay->total : position;
+
+    while (replay->position < position) {
+        ReplayMove* move = &(replay->moves[replay->position++]);
+        attempt_place(move->row, move->col, move->rotation, &(game->grid),
+                &(game->players[game->currentPlayer]));
+        next_turn(game);
+    }
+    while (replay->position > position) {
+        ReplayMove* move = &(replay->moves[--replay->position]);
+        game->moveCount--;
+        game->currentPlayer = (replay->startPlayer + replay->position) % 2;
+        game->currentTile = (replay->startTile + replay->position) % 
+                game->numTiles;
+        undo_place(move->row, move->col, move->rotation, &(game->grid), 
+                &(game->players[game->currentPlayer]));
+    }
+}
+
+/*
+ * Undo function. Takes the row and column of a move that was played, the
+ * rotation of the tile played, the gameboard and the player who played 
+ * it, and empties every cell the move filled. Boards with a legal move 
+ * index can't be undone.
+ */
+void undo_place(int row, int col, Rotation* rotation, Board* grid, 
+        Player* player) {
+    int rowOffset = row - TILE_CENTRE;
+    int colOffset = col - TILE_CENTRE;
+    int plane = icon_plane(player->icon);
+
+    for (int i = rotation->top; i <= rotation->bottom; i++) {
+        unsigned int bits = (rotation->mask >> (i * TILE_WIDTH)) & 
+                TILE_ROW_MASK;
+        board_clear(grid, OCCUPIED_PLANE, i + rowOffset, colOffset, bits);
+        board_clear(grid, plane, i + rowOffset, colOffset, bits);
+    }
+    if (grid->prefix != NULL) {
+        update_prefix_counts(grid, rowOffset + rotation->top, 
+                rowOffset + rotation->bottom);
+    }
+}
 
-        if (*currentRow < -2) {
-            *currentRow = height + 2;
+/*
+ * Automatic player algorithm type 2. Takes the player of type 2, the 
+ * game board itself, the current tile to be played, a search pool (may be
+ * NULL) and a placement to fill in, and begins searching for a valid move
+ * as per the algorithm in spec, skipping past positions no angle of the 
+ * tile fits a board row at a time. Large searches are split over the pool.
+ * Returns 1 upon finding a valid move and making it; 0 otherwise.
+ */
+int auto_play_two(Player* player, Board* grid, Tile* tile, 
+        SearchPool* pool, Placement* move) {
+    ScanOrder order;
+
+    init_scan_order(&order, grid, tile, player->lastRow, player->lastCol, 
+            (player->playerNum == 1) ? 1 : -1);
+    order.anglesFirst = 0;
+    for (int angle = 0; angle <= MAX_ANGLE; angle += ROTATION_STEP) {
+        if (tile_rotation(tile, angle)->angle == angle) { //Skip repeats
+            order.angles[order.angleCount++] = angle;
+        }
+    }
+    order.total = order.positions * order.angleCount;
+    if (pool != NULL && order.total >= PARALLEL_MIN_PROBES) {
+        if (!parallel_search(&order, pool, player, move)) {
+            return 0;
+        }
+    } else {
+        long step = scan_steps(&order, 0, order.total);
+        if (step < 0) {
+            return 0; //Reached starting pos again
         }
+        scan_step(&order, step, move);
+        commit_place(move->row, move->col, tile_rotation(tile, move->angle),
+                grid, player);
     }
+    player->lastRow = move->row;
+    player->lastCol = move->col; //Update with the last valid pos
+    return 1;
 }
 
 /*
@@ -476,563 +1988,2873 @@ void print_auto_move(int currentRow, int currentCol, int currentAngle,
 /*
  * Automatic player algorithm one. Takes the player of type 1,
  * the starting row and columns for the algorithm to begin 
- * searching with, the height and width of the board, the
- * tile to be played, the game board itself, and pointers to 
- * the current games last legal move position.
+ * searching with, the tile to be played, the game board itself, 
+ * a search pool (may be NULL) and a placement to fill in with the move 
+ * made. Large searches are split over the pool.
  *
  * Begins searching for a valid play as per the algorithm in 
- * specification. 
+ * specification, skipping past positions the tile doesn't fit a board 
+ * row at a time. 
  *
  * Returns 1 on successful play, 0 otherwise.
  */
-int auto_play_one(Player* player, int rStart, int cStart, int height,
-        int width, Tile* tile, char*** grid, int* row, int* col) {
-    int currentRow = rStart; //
-    int currentCol = cStart;
-    int currentAngle = 0;
-    int searching = 1;
-
-    while (searching) {
-        
-        //Tries to place the tile on the grid with current index/theta
-        if (attempt_place(currentRow, currentCol, rotate_tile(tile, 
-                currentAngle / ROTATION_STEP), grid, height, width, player)) { 
-            //update_last_play(row, col, currentRow, currentCol); 
-            print_auto_move(currentRow, currentCol, currentAngle, player);
-            return 1; //Placed!
-        } else {
-            currentCol++;
-
-            if (currentCol > (width + 2)) {
-                currentCol = -2;
-                currentRow++;
-            }
-
-            if (currentRow > (height + 2)) {
-                currentRow = -2;
-            }
-        }
+int auto_play_one(Player* player, int rStart, int cStart, Tile* tile, 
+        Board* grid, SearchPool* pool, Placement* move) {
+    ScanOrder order;
+
+    init_scan_order(&order, grid, tile, rStart, cStart, 1);
+    for (int angle = 0; angle < MAX_ANGLE; 
+            angle = next_rotation_angle(tile, angle)) {
+        order.angles[order.angleCount++] = angle; //270 is never tried
+    }
+    order.total = order.positions * order.angleCount;
+    if (pool != NULL && order.total >= PARALLEL_MIN_PROBES) {
+        return parallel_search(&order, pool, player, move);
+    }
 
-        if (currentRow == rStart && currentCol == cStart) {
-            currentAngle += ROTATION_STEP;
-        }
-        
-        if (currentAngle == MAX_ANGLE) {
-            break; 
-        }
+    long step = scan_steps(&order, 0, order.total);
+    if (step < 0) {
+        return 0; //No matches
     }
-    return 0; //No matches
+    scan_step(&order, step, move);
+    commit_place(move->row, move->col, tile_rotation(tile, move->angle), 
+            grid, player);
+    return 1; //Placed!
 }
 
 /*
- * Memory function to ensure game over checks don't cause memory issues.
- * Takes a copy of the gameboard, and the height of the board, and frees
- * the memory associated with these addresses.
+ * Automatic player algorithm type 3. Takes the player of type 3, the game
+ * board, the tile to be played, the tile the opponent plays next, an 
+ * arena for scratch memory and a placement to fill in, and makes the move
+ * choose_greedy_move picks.
+ * Returns 1 upon finding a valid move and making it; 0 otherwise.
  */
-void free_grid(char*** grid, int height) {
-    for (int i = 0; i < height; i++) {
-        free((*grid)[i]);
+int auto_play_three(Player* player, Board* grid, Tile* tile, Tile* nextTile,
+        Arena* scratch, Placement* move) {
+    if (!choose_greedy_move(grid, tile, nextTile, scratch, move)) {
+        return 0;
     }
-
-    free(*grid);
+    commit_place(move->row, move->col, tile_rotation(tile, move->angle), 
+            grid, player);
+    player->lastRow = move->row;
+    player->lastCol = move->col; //Update with the last valid pos
+    return 1;
 }
 
 /*
- * Game over check function. Takes the current fitz gameboard, the
- * gameboard height and width, and the current tile to be played.
- * Clones the board and checks every rotation of the tile on every
- * point of the board until a match is found.
- * Returns 1 if a valid move exists on the current board, 0
- * otherwise.
+ * Greedy search function. Takes a gameboard, the tile to be played, the
+ * tile the opponent plays next, an arena to take the map of the 
+ * opponent's placements from (given back before returning) and a 
+ * placement to fill in. Tries every 
+ * distinct rotation of the tile at every position, row by row from the 
+ * top left, and picks the legal placement which leaves the opponent the 
+ * fewest legal placements of their tile (the first found on a tie). The 
+ * opponent's placements are found once; each candidate then only takes 
+ * off those its own cells would cover. Doesn't change the board.
+ * Returns 1 if a placement was found, 0 otherwise.
  */
-int check_game_over(char*** grid, int height, int width, Tile* tile) {
-    char** gridClone;
-    create_new_grid(height, width, &gridClone);
-    for (int i = 0; i < height; i++) {
-        for (int j = 0; j < width; j++) {
-            gridClone[i][j] = (*grid)[i][j];
+int choose_greedy_move(Board* grid, Tile* tile, Tile* nextTile, 
+        Arena* scratch, Placement* move) {
+    Shape* reply = nextTile->shape;
+    long stride = grid->width + 2 * GREEDY_PAD;
+    long plane = (grid->height + 2 * GREEDY_PAD) * stride;
+    ArenaMark mark = arena_mark(scratch);
+    unsigned char* legal = (unsigned char*) arena_calloc(scratch, plane * 
+            reply->rotationCount, 1);
+    long replies = count_replies(grid, reply, legal, stride);
+    long offsets[ROTATION_COUNT][ROTATION_COUNT][MAX_OVERLAPS];
+    int overlaps[ROTATION_COUNT][ROTATION_COUNT];
+    long best = -1;
+
+    for (int k = 0; k < tile->rotationCount; k++) {
+        for (int n = 0; n < reply->rotationCount; n++) {
+            overlaps[k][n] = overlap_offsets(&(tile->rotations[k]), 
+                    &(reply->rotations[n]), stride, offsets[k][n]);
         }
-    } //Clone the current grid contents
-
-    Player dummyPlayer;
-    dummyPlayer.icon = 'X'; //Sentinel used so there's something to place
-
-    for (int i = -2; i < height + 2; i++) { //-2 +2 to account for the out
-        for (int j = -2; j < width + 2; j++) { //of bound space
+    }
 
-            if (attempt_place(i, j, *tile, &gridClone,
-                    height, width, &dummyPlayer)) {
-                free_grid(&gridClone, height); //Stops memory issues
-                return 1;
-            }
+    for (int row = -2; row <= grid->height + 2 && best != 0; row++) {
+        for (int col = -2; col <= grid->width + 2 && best != 0; col++) {
+            long corner = (row - TILE_CENTRE + GREEDY_PAD) * stride + 
+                    (col - TILE_CENTRE + GREEDY_PAD);
+            for (int k = 0; k < tile->rotationCount; k++) {
+                if (!can_place(row, col, &(tile->rotations[k]), grid)) {
+                    continue;
+                }
 
-            for (int k = 1; k < ROTATION_COUNT; k++) { //Try with 3 rotations
-                if (attempt_place(i, j, rotate_tile(tile, k), &gridClone,
-                        height, width, &dummyPlayer)) {
-                    free_grid(&gridClone, height);
-                    return 1;
+                long left = replies;
+                for (int n = 0; n < reply->rotationCount; n++) {
+                    unsigned char* cells = legal + n * plane + corner;
+                    for (int o = 0; o < overlaps[k][n]; o++) {
+                        left -= cells[offsets[k][n][o]]; //Covered reply
+                    }
+                }
+                if (best == -1 || left < best) {
+                    best = left;
+                    move->row = row;
+                    move->col = col;
+                    move->angle = tile->rotations[k].angle;
                 }
             }
         }
     }
 
-    free_grid(&gridClone, height);
-    return 0; //Went through entire grid, no plays found.
+    arena_release(scratch, mark);
+    return best != -1;
 }
 
-
 /*
- * Placement function. Takes the row and column of the attempted move,
- * the tile to be played, the current gameboard, the height and width 
- * of the gameboard, and the player making a move.
- * Tries to place the tile on the designated board coordinates.
- * If successful, returns 1. Else, returns 0.
+ * Greedy search helper. Takes a gameboard, a tile shape, a zeroed map with
+ * one plane per rotation of the shape, and the length of a map row. Marks
+ * every board position where the top left corner of a rotation's bounding
+ * box gives a legal placement, offset by GREEDY_PAD rows and columns, 
+ * reading the legal move index if the board has one. A rotation with no 
+ * filled cells is counted once and marks nothing.
+ * Returns the number of legal placements.
  */
-int attempt_place(int row, int col, Tile tile, char*** grid, int height,
-        int width, Player* player) {
-    
-    int rowOffset = row - TILE_CENTRE; //Create transposed coordinates
-    int colOffset = col - TILE_CENTRE; //Based from the centre of the tile
-    char icon = player->icon;
-    if (row < -2 || col < -2 || row > height + 2 || col > width + 2) {
-        return 0; //Invalid, placement will cause entire tile to be off board
-    }
+long count_replies(Board* grid, Shape* shape, unsigned char* legal, 
+        long stride) {
+    long plane = (grid->height + 2 * GREEDY_PAD) * stride;
+    long count = 0;
+
+    for (int n = 0; n < shape->rotationCount; n++) {
+        Rotation* rotation = &(shape->rotations[n]);
+        if (rotation->top > rotation->bottom) {
+            count++; //Fits anywhere
+            continue;
+        }
 
-    for (int i = 0; i < TILE_HEIGHT; i++) { 
-        for (int j = 0; j < TILE_WIDTH; j++) { 
-            if (((i + rowOffset) < 0 || (i + rowOffset) >= height) ||
-                    ((j + colOffset < 0) || (j + colOffset >= width))) {
-                //This means one of the offsetted cords is out of bounds
-                if ((tile.tileData[i][j]) == '!') {
-                    return 0;
+        int lastRow = grid->height - (rotation->bottom - rotation->top) - 1;
+        int lastCol = grid->width - (rotation->right - rotation->left) - 1;
+        for (int i = 0; i <= lastRow; i++) {
+            uint64_t* rowBits = (grid->index != NULL) ? 
+                    index_row(grid, shape->id, n, i) : NULL;
+            unsigned char* cells = legal + n * plane + 
+                    (i + GREEDY_PAD) * stride + GREEDY_PAD;
+            for (int j = 0; j <= lastCol; j++) {
+                if (rowBits != NULL ? test_bit(rowBits, j) : 
+                        tile_fits(grid, rotation, i, j)) {
+                    cells[j] = 1;
+                    count++;
                 }
-            } else { //Translated coords are within the board
-
-                if (((*grid)[i + rowOffset][j + colOffset] != '.') && 
-                        tile.tileData[i][j] != ',') {
-                    return 0; //If there is data here already and we have a !
-                } 
             }
         }
     }
-    //If we reach here without exiting then the tile is good!
-    for (int i = 0; i < TILE_HEIGHT; i++) {
-        for (int j = 0; j < TILE_WIDTH; j++) {
-            if (tile.tileData[i][j] != ',') {
-                (*grid)[i + rowOffset][j + colOffset] = icon;
+    return count;
+}
+
+/*
+ * Greedy search helper. Takes a rotation being placed, a rotation of the
+ * opponent's tile shape, the length of a row in count_replies' map and an
+ * array of at least MAX_OVERLAPS offsets. Fills in the map offsets, from 
+ * the placed tile's top left corner, of every reply corner whose cells 
+ * would overlap the placed cells. Returns the number of offsets.
+ */
+int overlap_offsets(Rotation* placed, Rotation* reply, long stride, 
+        long* offsets) {
+    int seen[2 * TILE_HEIGHT - 1][2 * TILE_WIDTH - 1] = {{0}};
+    int count = 0;
+
+    for (int cell = 0; cell < TILE_CELLS; cell++) {
+        if (!((placed->mask >> cell) & 1)) {
+            continue;
+        }
+        for (int other = 0; other < TILE_CELLS; other++) {
+            if (!((reply->mask >> other) & 1)) {
+                continue;
+            }
+            int rowShift = cell / TILE_WIDTH - other / TILE_WIDTH;
+            int colShift = cell % TILE_WIDTH - other % TILE_WIDTH;
+            if (!seen[rowShift + TILE_HEIGHT - 1]
+                    [colShift + TILE_WIDTH - 1]++) {
+                offsets[count++] = rowShift * stride + colShift;
             }
         }
     }
-
-    return 1;
+    return count;
 }
 
 /*
- * Input check function for h players. Takes pointers to the attempted 
- * row and col, a status flag struct, a pointer to the attempted 
- * rotation angle, and a GameState struct for saving.
- * Tries to read from stdin into a string. If successful, tries to validate 
- * the data retrieved as per the specification. If successful, returns 1. 
- * Else, returns 0 if any of these checks fail.
+ * Automatic player algorithm type 4. Takes the player of type 4, the game
+ * being played and a placement to fill in, and makes the move found by a
+ * game tree search of the position (see choose_search_move) within the 
+ * game's time budget. With --stats, reports the nodes searched, the depth
+ * reached and the nodes searched a second to stderr. Returns 1 upon 
+ * finding a valid move and making it; 0 otherwise.
  */
-int check_user_input(int* row, int* col, DataReadFlag* readFlag, 
-        int* rotateAngle, GameState* currentGameData) {
-    char* userInput;
-    int valid = read_stdin(&userInput, readFlag, currentGameData);
-
-    if (!valid) {
-        return 0; //Read failed somehow but it wasnt exit worthy
+int auto_play_four(Player* player, GameState* game, Placement* move) {
+    Search search;
+    init_search(&search, game);
+    int found = choose_search_move(&search, move);
+    double seconds = elapsed_seconds(&(search.start));
+    free_search(&search);
+    COUNT(searchNodes, search.nodes);
+    if (game->stats) {
+        fprintf(stderr, "Player %c searched %ld nodes to depth %d in %.3fs "
+                "(%.0f nodes/sec)\n", player->icon, search.nodes, 
+                search.depth, seconds, search.nodes / seconds);
     }
-
-    valid = validate_inputs(row, col, rotateAngle, &userInput);
-
-    if (!valid) {
-        return 0; //Numbers weren't valid
+    if (!found) {
+        return 0;
     }
 
+    Tile* tile = game->tiles[game->currentTile];
+    commit_place(move->row, move->col, tile_rotation(tile, move->angle), 
+            &(game->grid), player);
+    player->lastRow = move->row;
+    player->lastCol = move->col; //Update with the last valid pos
     return 1;
 }
 
 /*
- * Helper function. Clears stdin in the event of too much data inputted
- * to fitz to ensure further plays are not affected by the overflow.
+ * Search setup function. Takes a search to fill in and the game it 
+ * searches, and copies the game's board (without its move index) into 
+ * the game's arena for moves to be made and unmade on. Hashes the board, 
+ * clears the transposition table and starts the clock on the game's time
+ * budget.
  */
-void clear_stdin(void) {
-    char voidArr[MAX_INPUT]; //Used to dump anything in stdin
-    char* stringHolder;
-    
-    do {
-        stringHolder = fgets(voidArr, sizeof(voidArr), stdin);
-        //Throw all the data still in stdin into the abyss, until we hit
-        //new line or there is nothing left.
-    } while (stringHolder != NULL && (strchr(voidArr, '\n') == NULL));
+void init_search(Search* search, GameState* game) {
+    Board* grid = &(game->grid);
+    Board* board = &(search->board);
+    search->arena = &(game->arena);
+    search->mark = arena_mark(search->arena);
+    create_arena_grid(grid->height, grid->width, board, search->arena);
+    memcpy(board->planes, grid->planes, sizeof(uint64_t) * PLANE_COUNT * 
+            (grid->height + 2 * BOARD_PAD) * grid->rowWords);
+
+    search->tiles = game->tiles;
+    search->numTiles = game->numTiles;
+    search->rootTile = game->currentTile;
+    search->players = game->players;
+    search->rootPlayer = game->currentPlayer;
+    search->hash = 0;
+    for (int i = 0; i < board->height; i++) {
+        for (int j = 0; j < board->width; j++) {
+            if (get_cell(board, i, j) != '.') {
+                search->hash ^= zobrist_key((uint64_t) i * board->width + j);
+            }
+        }
+    }
+    search->tableMask = ((size_t) 1 << SEARCH_TABLE_BITS) - 1;
+    search->table = (TableEntry*) arena_calloc(search->arena, 
+            search->tableMask + 1, sizeof(TableEntry));
+    search->nodes = 0;
+    search->depth = 0;
+    search->budget = game->searchTime / 1000.0;
+    search->stopped = 0;
+    search->rootMove = -1;
+    clock_gettime(CLOCK_MONOTONIC, &(search->start));
 }
 
 /*
- * Input function. Takes a pointer to the string to be read, a status flag
- * struct, and a GameState struct for saving.
- * Allocates memory for the string as per spec, and tries to read
- * into this string. If data overflows the buffer provided,
- * clears stdin to ensure an empty stdin.
- *
- * Once data collected, if of valid size, attempts to clean
- * it. If data is of valid size and clean as per the specification,
- * return 1. In all other cases, return 0. fitz exits if EOF detected
- * and no other data present with status 10. If save present in collected
- * string, attempts to save.
+ * Memory function. Takes a search and gives its board and table back to
+ * the arena they came from.
  */
-int read_stdin(char** userInput, DataReadFlag* readFlag, 
-        GameState* currentGameState) {
-    //+2 to memory to account for \0 and overflow data
-    *userInput = (char*) malloc(sizeof(char) * (MAX_INPUT + 2)); 
-
-    if (fgets(*userInput, (MAX_INPUT + 2), stdin) != NULL) { 
-        char* newlinePos = strchr(*userInput, '\n');
-        if (newlinePos != NULL) {
-            *newlinePos = '\0';
-        } else { //No newline in string; EOF input or overflowed data
-            if (strlen(*userInput) == 71) { //Data read in was too big
-                if (!feof(stdin)) { //If this is true, means theres still data
-                    clear_stdin(); //in stdin
-                    return 0;
-                } else { //Else there is nothing left in the pipe, 
-                    return 0; //Yet we still overflowed
-                }
-            } //If the length isn't 71 is must be lower; therefore, valid 
-            printf("\n"); //If it's EOF include a newline
-        } 
-    } else {
-        readFlag->returnVal = END_OF_INPUT; //EOF with no data
-        check_load_errors(*readFlag);
-    }
+void free_search(Search* search) {
+    arena_release(search->arena, search->mark);
+}
 
-    if (!(strncmp(*userInput, "save", 4))) { //Check if we have a save attempt
-        attempt_save(currentGameState, userInput);
-        return 0; //Used to reprompt later for valid move
+/*
+ * Search function. Takes a set up search and a placement to fill in. 
+ * Searches the position with alpha-beta pruning one move deeper at a time
+ * (iterative deepening) until the time budget runs out, the result is 
+ * decided or MAX_SEARCH_DEPTH is reached, and fills in the best move of
+ * the deepest search. A search cut short still gives its best move so far,
+ * since it always starts with the best move of the search before.
+ * Returns 1 if a move was found, 0 if there is none.
+ */
+int choose_search_move(Search* search, Placement* move) {
+    for (int depth = 1; depth <= MAX_SEARCH_DEPTH; depth++) {
+        int score = search_node(search, depth, -WIN_SCORE - 1, 
+                WIN_SCORE + 1, 0);
+        if (search->stopped) {
+            break;
+        }
+        search->depth = depth;
+        if (score >= WIN_SCORE || score <= -WIN_SCORE) {
+            break;
+        }
     }
 
-    if (clean_inputs(userInput)) { //Check if valid data
-        return 1;
-    } else {
+    if (search->rootMove == -1) {
         return 0;
     }
+    Tile* tile = search->tiles[search->rootTile];
+    int rotation = decode_search_move(&(search->board), search->rootMove, 
+            &(move->row), &(move->col));
+    move->angle = tile->rotations[rotation].angle;
+    return 1;
 }
 
 /*
- * Saving function. Takes a GameState struct with current game data, and
- * a user defined string from stdin. 
- * Attempts to save to the filepath specified in user defined string.
- * If file cannot be reached, return, else write to file with
- * current game data as per specificed format.
+ * Search function. Takes a search, the depth left to search, the alpha 
+ * and beta bounds, and how many moves the position is from the root. 
+ * Scores the position for the player to move (negamax): the number of 
+ * legal placements of their tile at depth 0, else the best of its moves' 
+ * scores negated, or -WIN_SCORE if there are none. Looks the position up
+ * in the transposition table first and stores its result after, and 
+ * records the best move at the root. Returns 0 once the search is out of
+ * time, which is checked every SEARCH_CHECK_NODES nodes.
  */
-void attempt_save(GameState* currentGameState, char** userInput) {
-    char* saveFilePath = (char*) malloc(sizeof(char) * MAX_INPUT);
-    strncpy(saveFilePath, (*userInput + 4), MAX_INPUT); //+4 to ignore "save"
-    FILE* writeLocation = fopen(saveFilePath, "w");
-    if (writeLocation == NULL) {
-        fprintf(stderr, "Unable to save game\n");
-        return; //Can't save
-    } else {
-        fprintf(writeLocation, "%d %d %d %d\n", currentGameState->currentTile,
-                currentGameState->currentPlayer, currentGameState->gridHeight,
-                currentGameState->gridWidth);
+int search_node(Search* search, int depth, int alpha, int beta, int ply) {
+    Tile* tile = search->tiles[(search->rootTile + ply) % search->numTiles];
+    Board* board = &(search->board);
+
+    search->nodes++;
+    if (search->rootMove != -1 && search->nodes % SEARCH_CHECK_NODES == 0 &&
+            elapsed_seconds(&(search->start)) > search->budget) {
+        search->stopped = 1;
+    }
+    if (search->stopped) {
+        return 0;
+    }
+    if (depth == 0) {
+        long count = count_placements(board, tile->shape);
+        return (count > 0) ? (int) count : -WIN_SCORE;
+    }
 
-        for (int i = 0; i < currentGameState->gridHeight; i++) {
-            for (int j = 0; j < currentGameState->gridWidth; j++) {
-                fprintf(writeLocation, "%c", currentGameState->grid[i][j]);
+    uint64_t key = search->hash ^ zobrist_key(ZOBRIST_TILE + 
+            (search->rootTile + ply) % search->numTiles) ^
+            (((search->rootPlayer + ply) % 2) ? zobrist_key(ZOBRIST_SIDE) : 0);
+    TableEntry* entry = &(search->table[key & search->tableMask]);
+    int hint = -1;
+    if (entry->key == key) {
+        hint = entry->bestMove;
+        if (entry->depth >= depth && (entry->bound == EXACT_BOUND || 
+                (entry->bound == LOWER_BOUND && entry->score >= beta) ||
+                (entry->bound == UPPER_BOUND && entry->score <= alpha))) {
+            if (ply == 0) {
+                search->rootMove = hint;
             }
-            fprintf(writeLocation, "\n");
+            return entry->score;
         }
     }
 
-    fclose(writeLocation);
-    free(saveFilePath);
+    SearchNode node = {depth, alpha, beta, ply, -WIN_SCORE, -1, -1};
+    if (hint != -1) { //Best move last time goes first
+        int row, col;
+        int rotation = decode_search_move(board, hint, &row, &col);
+        if (rotation < tile->rotationCount && 
+                can_place(row, col, &(tile->rotations[rotation]), board)) {
+            search_move(search, &node, tile, rotation, row, col);
+            node.skipMove = hint;
+        }
+    }
+
+    for (int k = 0; k < tile->rotationCount && node.alpha < node.beta; 
+            k++) {
+        Rotation* rotation = &(tile->rotations[k]);
+        if (rotation->top > rotation->bottom) { //Fits anywhere; try once
+            search_move(search, &node, tile, k, -2, -2);
+            continue;
+        }
+        for (int i = -TILE_HEIGHT + 1; i <= board->height && 
+                node.alpha < node.beta; i++) {
+            uint64_t fits[MAX_ROW_WORDS];
+            fit_row(board, rotation, i, fits);
+            for (int w = 0; w < board->rowWords && node.alpha < node.beta; 
+                    w++) {
+                for (uint64_t bits = fits[w]; bits != 0 && 
+                        node.alpha < node.beta; bits &= bits - 1) {
+                    int col = w * WORD_BITS + __builtin_ctzll(bits) - 
+                            BOARD_PAD + TILE_CENTRE;
+                    search_move(search, &node, tile, k, i + TILE_CENTRE, 
+                            col);
+                }
+            }
+        }
+    }
+
+    if (search->stopped) {
+        return 0;
+    }
+    entry->key = key;
+    entry->depth = depth;
+    entry->score = node.best;
+    entry->bound = (node.best <= alpha) ? UPPER_BOUND : 
+            (node.best >= beta) ? LOWER_BOUND : EXACT_BOUND;
+    entry->bestMove = node.bestMove;
+    return node.best;
 }
 
 /*
- * Cleaning function. Takes user generated string from stdin
- * and checks it is valid as per specification requirements.
- * If data is valid, return 1, else return 0 in all other cases.
+ * Search helper. Takes a search, the node being searched, its tile, and a
+ * legal move of that tile (rotation number, row and column). Skips the 
+ * move if it was the node's table move, already searched. Otherwise makes
+ * the move, searches the position after it, unmakes it, and raises the 
+ * node's best score and alpha bound if the move is better.
  */
-int clean_inputs(char** userInput) {
-    char c, prevData = ' ';
-    int numSpaces = 0, index = 0;
+void search_move(Search* search, SearchNode* node, Tile* tile, int rotation,
+        int row, int col) {
+    int number = encode_search_move(&(search->board), rotation, row, col);
+    if (search->stopped || number == node->skipMove) {
+        return;
+    }
 
-    do {
-        c = (*userInput)[index++]; 
-    
-        if (c == '\0') { //Hit end of string
-            break;
+    Player* player = &(search->players[(search->rootPlayer + node->ply) % 2]);
+    Rotation* placed = &(tile->rotations[rotation]);
+    make_search_move(search, placed, row, col, player);
+    int score = -search_node(search, node->depth - 1, -node->beta, 
+            -node->alpha, node->ply + 1);
+    unmake_search_move(search, placed, row, col, player);
+    if (search->stopped) {
+        return;
+    }
+
+    if (score > node->best || node->bestMove == -1) {
+        node->best = score;
+        node->bestMove = number;
+        if (node->ply == 0) {
+            search->rootMove = number;
         }
+    }
+    if (score > node->alpha) {
+        node->alpha = score;
+    }
+}
 
-        if (c == ' ') {
-            if (prevData == ' ') { //If this returns 1, two spaces
-                return 0; //Also catches leading space
-            } else {
-                if (++numSpaces > 2) { //This signifies the end of an int
-                    return 0; //Too many numbers given 
-                }
-            } 
-        } else if (c == '+' || c == '-') { //Only let +/- appear
-            if (prevData != ' ') { //Ensure no sign appears after digits
-                return 0;
-            } else {
-                continue;
-            }
-        } else if (!isdigit(c)) { 
-            return 0; //Not a number
-            
-        } 
-        prevData = (char) c;
-    } while (c != '\0');
+/*
+ * Make function. Takes a search, a legal tile rotation, the row and column
+ * to place it at and the player placing it, and plays it on the search's
+ * board (which has no index to update), hashing in its cells.
+ */
+void make_search_move(Search* search, Rotation* rotation, int row, int col,
+        Player* player) {
+    commit_place(row, col, rotation, &(search->board), player);
+    search->hash ^= placement_key(&(search->board), rotation, row, col);
+}
 
-    if (numSpaces != 2) { //Was there more than 2 spaces? 2 spaces == 3 ints
-        return 0; //As no trailing spaces
+/*
+ * Unmake function. Takes the same arguments as make_search_move for the
+ * last move made, and takes that move back.
+ */
+void unmake_search_move(Search* search, Rotation* rotation, int row, 
+        int col, Player* player) {
+    undo_place(row, col, rotation, &(search->board), player);
+    search->hash ^= placement_key(&(search->board), rotation, row, col);
+}
+
+/*
+ * Hashing function. Takes a board, a tile rotation and the row and column
+ * it is placed at, and returns the Zobrist keys of the cells it fills 
+ * combined.
+ */
+uint64_t placement_key(Board* board, Rotation* rotation, int row, int col) {
+    uint64_t key = 0;
+    for (uint32_t cells = rotation->mask; cells != 0; cells &= cells - 1) {
+        int cell = __builtin_ctz(cells);
+        int i = row - TILE_CENTRE + cell / TILE_WIDTH;
+        int j = col - TILE_CENTRE + cell % TILE_WIDTH;
+        key ^= zobrist_key((uint64_t) i * board->width + j);
     }
-    return 1;
+    return key;
 }
 
 /*
- * Validation function. Takes pointers to the current row and column to be
- * played, a pointer to the current angle to be played, as well as a
- * cleaned user defined string from stdin.
- * Attempts to convert the string contents to values. Checks values
- * meet specification criteria regarding validity. If valid, reutrns 1,
- * else returns 0. 
- * Note: board size checks handled by attempted place
- * */
-int validate_inputs(int* row, int* col, int* rotateAngle, char** userInput) {
-    char* currentInt = *userInput;
-    int index = 0, angle = 0;
-    int inputs[3]; //String precleaned to have 3 ints 
+ * Hashing function. Takes a number and returns its Zobrist key: a fixed 
+ * pseudo random 64 bit value (from the splitmix64 mixer), so no table of
+ * keys needs building. Cells are numbered row by row from 0, tile numbers
+ * are offset by ZOBRIST_TILE, and player two to move is ZOBRIST_SIDE.
+ */
+uint64_t zobrist_key(uint64_t number) {
+    uint64_t key = number + 0x9E3779B97F4A7C15ull;
+    key = (key ^ (key >> 30)) * 0xBF58476D1CE4E5B9ull;
+    key = (key ^ (key >> 27)) * 0x94D049BB133111EBull;
+    return key ^ (key >> 31);
+}
 
-    while (*currentInt != '\0') {
-        if (isdigit(*currentInt) || ((currentInt[0] == '+' || 
-                currentInt[0] == '-') && isdigit(currentInt[1]))) { //neg/pos
-            inputs[index++] = strtol(currentInt, &currentInt, 10);
-        } else {
-            currentInt++;
+/*
+ * Takes a board, a tile rotation number and the row and column of a move,
+ * and returns a single number for the move.
+ */
+int encode_search_move(Board* board, int rotation, int row, int col) {
+    return ((row + 2) * (board->width + 5) + col + 2) * ROTATION_COUNT + 
+            rotation;
+}
+
+/*
+ * Takes a board and a move number (see encode_search_move), fills in the 
+ * move's row and column, and returns its rotation number.
+ */
+int decode_search_move(Board* board, int number, int* row, int* col) {
+    int position = number / ROTATION_COUNT;
+    *row = position / (board->width + 5) - 2;
+    *col = position % (board->width + 5) - 2;
+    return number % ROTATION_COUNT;
+}
+
+/*
+ * Counting function. Takes a gameboard and a tile shape, and returns the
+ * number of legal placements of the shape over all its rotations (as the
+ * legal move index counts them), testing a board row of positions at a 
+ * time with fit_row. A rotation with no filled cells counts once.
+ */
+long count_placements(Board* grid, Shape* shape) {
+    long count = 0;
+    for (int n = 0; n < shape->rotationCount; n++) {
+        Rotation* rotation = &(shape->rotations[n]);
+        if (rotation->top > rotation->bottom) {
+            count++; //Fits anywhere
+            continue;
+        }
+        for (int i = 0; i < grid->height; i++) {
+            uint64_t fits[MAX_ROW_WORDS];
+            fit_row(grid, rotation, i, fits);
+            for (int w = 0; w < grid->rowWords; w++) {
+                count += __builtin_popcountll(fits[w]);
+            }
         }
     }
+    return count;
+}
 
-    angle = inputs[2]; //used for clarity
+/*
+ * Fit check function. Takes a gameboard, a tile rotation with filled 
+ * cells, the board row of the tile's top left corner (no more than 4 rows
+ * off the board) and a buffer of the board's rowWords words. Sets bit 
+ * (col + BOARD_PAD) of the buffer for every column col the tile's top 
+ * left corner could be put in, 64 columns at a time, as tile_fits would.
+ */
+void fit_row(Board* grid, Rotation* rotation, int rowOffset, 
+        uint64_t* fits) {
+    for (int w = 0; w < grid->rowWords; w++) {
+        fits[w] = fit_word(grid, rotation, rowOffset, w);
+    }
+}
 
-    if (angle != 0 && angle != 90 && angle != 180 && angle != 270) {
+/*
+ * Fit check function, as per fit_row, for one word of the row. Takes the
+ * number of the word, and returns it.
+ */
+uint64_t fit_word(Board* grid, Rotation* rotation, int rowOffset, int word) {
+    uint64_t fits = ~(uint64_t) 0;
+    COUNT(wordChecks, 1);
+
+    for (int i = rotation->top; i <= rotation->bottom; i++) {
+        uint64_t* rowBits = board_row(grid, OCCUPIED_PLANE, rowOffset + i);
+        uint64_t next = (word + 1 < grid->rowWords) ? rowBits[word + 1] :
+                ~(uint64_t) 0; //Past the wall
+        for (uint64_t cells = rotation->rows[i]; cells != 0; 
+                cells &= cells - 1) {
+            int shift = __builtin_ctzll(cells); //Occupied from col
+            uint64_t occupied = (shift == 0) ? rowBits[word] : 
+                    (rowBits[word] >> shift) | (next << (WORD_BITS - shift));
+            fits &= ~occupied;
+        }
+    }
+    return fits;
+}
+
+/*
+ * Automatic player algorithm type 5. Takes the player of type 5, the game
+ * being played and a placement to fill in, and makes the move chosen by 
+ * a Monte Carlo tree search of the position (see choose_mcts_move). With
+ * --stats, reports the playouts made and the playouts made a second to 
+ * stderr. Returns 1 upon finding a valid move and making it; 0 otherwise.
+ */
+int auto_play_five(Player* player, GameState* game, Placement* move) {
+    long playouts = 0;
+    double seconds = 0;
+    int found = choose_mcts_move(game, move, &playouts, &seconds);
+    COUNT(mctsPlayouts, playouts);
+    if (game->stats) {
+        fprintf(stderr, "Player %c made %ld playouts in %.3fs (%.0f "
+                "playouts/sec)\n", player->icon, playouts, seconds, 
+                playouts / seconds);
+    }
+    if (!found) {
         return 0;
+    }
+
+    Tile* tile = game->tiles[game->currentTile];
+    commit_place(move->row, move->col, tile_rotation(tile, move->angle), 
+            &(game->grid), player);
+    player->lastRow = move->row;
+    player->lastCol = move->col; //Update with the last valid pos
+    return 1;
+}
+
+/*
+ * Monte Carlo tree search function. Takes a game, a placement to fill in 
+ * and somewhere to store the number of playouts made and the seconds 
+ * they took. Grows a separate tree on each of the game's search threads
+ * (root parallelisation), each with its own random seed, until the 
+ * game's time budget or playout budget runs out. The trees are handed to
+ * the game's search pool, so no threads are started for the move. Then 
+ * adds up the visits to each root move over every tree and fills in the
+ * most visited move.
+ * Returns 1 if a move was found, 0 if there is none.
+ */
+int choose_mcts_move(GameState* game, Placement* move, long* playouts,
+        double* seconds) {
+    int threads = (game->pool != NULL) ? game->pool->threads + 1 : 1;
+    ArenaMark mark = arena_mark(&(game->arena));
+    Mcts* trees = (Mcts*) arena_alloc(&(game->arena), sizeof(Mcts) * threads);
+    struct timespec start;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int t = 0; t < threads; t++) {
+        init_mcts(&(trees[t]), game, &start);
+        trees[t].random ^= zobrist_key((uint64_t) game->moveCount * 
+                threads + t); //Each tree explores differently
+        trees[t].maxPlayouts = (game->playouts + threads - 1) / threads;
+    }
+    if (game->pool != NULL) {
+        pthread_mutex_lock(&(game->pool->lock));
+        game->pool->trees = trees;
+        game->pool->treeCount = threads;
+        game->pool->nextTree = 0;
+        pthread_mutex_unlock(&(game->pool->lock));
+        run_pool(game->pool);
     } else {
-        *row = inputs[0]; //These will be checked for validity at placement
-        *col = inputs[1];
-        *rotateAngle = inputs[2];
+        grow_tree(&(trees[0]));
+    }
+    *seconds = elapsed_seconds(&start);
+
+    int bestMove = -1;
+    long bestVisits = 0;
+    *playouts = 0;
+    for (int t = 0; t < threads; t++) {
+        *playouts += trees[t].playouts;
+        MctsNode* root = &(trees[t].nodes[0]);
+        for (int c = 0; c < root->childCount; c++) {
+            int number = trees[t].nodes[root->firstChild + c].move;
+            long visits = root_visits(trees, threads, number);
+            if (visits > bestVisits || bestMove == -1) {
+                bestMove = number;
+                bestVisits = visits;
+            }
+        }
+    }
+
+    arena_release(&(game->arena), mark); //Every tree at once
+    if (bestMove == -1) {
+        return 0;
     }
 
+    Tile* tile = game->tiles[game->currentTile];
+    int rotation = decode_search_move(&(game->grid), bestMove, &(move->row), 
+            &(move->col));
+    move->angle = tile->rotations[rotation].angle;
     return 1;
 }
 
 /*
- * Printing function. Takes a tile to be printed, and prints it to 
- * stdout.
+ * Takes the trees of a search, the number of trees and a root move number,
+ * and returns the number of visits to that move over every tree.
  */
-void print_tile(Tile* tile) {
-    for (int i = 0; i < TILE_WIDTH; i++) {
-        for (int j = 0; j < TILE_HEIGHT; j++) {
-            printf("%c", tile->tileData[i][j]);
+long root_visits(Mcts* trees, int count, int number) {
+    long visits = 0;
+    for (int t = 0; t < count; t++) {
+        MctsNode* root = &(trees[t].nodes[0]);
+        for (int c = 0; c < root->childCount; c++) {
+            MctsNode* child = &(trees[t].nodes[root->firstChild + c]);
+            visits += (child->move == number) ? child->visits : 0;
         }
-        printf("\n");
     }
+    return visits;
 }
 
 /*
- * Loading function. Takes a file pointer, a status flag struct,
- * a filepath, and a pointer to the number of tiles fitz has.
- *
- * Attempts to read from given file to construct the tiles 
- * fitz will use for the current game. If any invalid data is 
- * encountered, as per the specification, fitz will exit with
- * relevant exit status. Otherwise, upon successful reading
- * and processing, return an array of filled Tile structs for use
- * in fitz.
+ * Tree setup function. Takes a tree to fill in, the game being searched 
+ * and when the search started. Copies the game's board (without its move
+ * index) to play out on, and creates the tree with just its root. Both
+ * are taken from the game's arena up front, as the tree may be grown on 
+ * one of the game's search pool threads.
  */
-Tile** load_tiles(FILE** tileFile, DataReadFlag* loadFlag, char* tileName, 
-        int* numTiles) { 
+void init_mcts(Mcts* tree, GameState* game, struct timespec* start) {
+    create_arena_grid(game->grid.height, game->grid.width, &(tree->board),
+            &(game->arena));
+    tree->game = game;
+    tree->nodeCapacity = MCTS_MAX_NODES;
+    tree->nodes = (MctsNode*) arena_alloc(&(game->arena), sizeof(MctsNode) * 
+            tree->nodeCapacity);
+    tree->nodes[0].move = -1;
+    tree->nodes[0].visits = tree->nodes[0].wins = 0;
+    tree->nodes[0].firstChild = -1;
+    tree->nodes[0].childCount = 0;
+    tree->nodeCount = 1;
+    tree->random = MCTS_SEED;
+    tree->playouts = 0;
+    tree->maxPlayouts = 0;
+    tree->start = start;
+    tree->budget = game->searchTime / 1000.0;
+}
 
-    int tileCount = 1; //Assume one tile in file; if not, will error later
-    Tile** tiles = (Tile**) malloc(sizeof(Tile*) * tileCount);
-    int pos = 0, col = 0, row = 0, point = 0;
-    char tempTile[TILE_HEIGHT][TILE_WIDTH]; //tiles are a fixed size
+/*
+ * Search pool function. Takes a search pool with a Monte Carlo search in
+ * progress and keeps claiming the next of its trees and growing it, until
+ * every tree has been claimed.
+ */
+void grow_trees(SearchPool* pool) {
+    while (1) {
+        pthread_mutex_lock(&(pool->lock));
+        int tree = pool->nextTree++;
+        pthread_mutex_unlock(&(pool->lock));
+        if (tree >= pool->treeCount) {
+            return;
+        }
+        grow_tree(&(pool->trees[tree]));
+    }
+}
 
-    *tileFile = open_file(tileName, loadFlag, TILE_FILE);
+/*
+ * Search function. Takes a tree and keeps making playouts with it until 
+ * its time or playout budget runs out, always making at least one.
+ */
+void grow_tree(Mcts* tree) {
+    do {
+        mcts_playout(tree);
+        tree->playouts++;
+    } while ((tree->maxPlayouts == 0 || tree->playouts < tree->maxPlayouts)
+            && elapsed_seconds(tree->start) < tree->budget);
+}
 
-    while (point != EOF) {
+/*
+ * Playout function. Takes a tree, and from a fresh copy of the game's 
+ * board walks down the tree playing the move of the most promising child 
+ * (UCT) at each node, expanding nodes as they are first reached, until a 
+ * child not yet visited is played (or a node is reached with the tree 
+ * too full to expand it). Plays the rest of the game out with a 
+ * rollout, then counts the visit, and the win for whichever player moved
+ * into each node on the way down.
+ */
+void mcts_playout(Mcts* tree) {
+    GameState* game = tree->game;
+    Board* board = &(tree->board);
+    int path[MAX_MCTS_DEPTH];
+    int depth = 0, node = 0, loser = -1;
+
+    memcpy(board->planes, game->grid.planes, sizeof(uint64_t) * 
+            PLANE_COUNT * (board->height + 2 * BOARD_PAD) * board->rowWords);
+    path[depth++] = node;
+    while (depth < MAX_MCTS_DEPTH) {
+        int ply = depth - 1;
+        if (tree->nodes[node].firstChild == -1) {
+            if (tree->nodeCount + MCTS_CHILDREN > tree->nodeCapacity) {
+                break; //Tree is full; play on from here
+            }
+            expand_mcts_node(tree, node, ply);
+        }
+        if (tree->nodes[node].childCount == 0) { //Nowhere to play
+            loser = (game->currentPlayer + ply) % 2;
+            break;
+        }
 
-        point = fgetc(*tileFile); //grab each char in file
-        if(!check_point(point, loadFlag)) { //Check it's valid (,!\n)
+        node = select_mcts_child(tree, node);
+        int row, col;
+        Tile* tile = game->tiles[(game->currentTile + ply) % game->numTiles];
+        int rotation = decode_search_move(board, tree->nodes[node].move, 
+                &row, &col);
+        commit_place(row, col, &(tile->rotations[rotation]), board, 
+                &(game->players[(game->currentPlayer + ply) % 2]));
+        path[depth++] = node;
+        if (tree->nodes[node].visits == 0) {
             break;
         }
+    }
 
-        tempTile[row][col++] = (char) point; //Put char in, incr column
+    if (loser == -1) {
+        loser = rollout(tree, depth - 1);
+    }
+    for (int i = 0; i < depth; i++) {
+        MctsNode* visited = &(tree->nodes[path[i]]);
+        visited->visits++;
+        if (i > 0 && (game->currentPlayer + i - 1) % 2 != loser) {
+            visited->wins++; //The player who moved here won
+        }
+    }
+}
 
-        if (col == TILE_WIDTH && row != (TILE_HEIGHT - 1)) { //Hit end of row
-            if(!check_row_end(tileFile)) { //Grabs next char
-                break; //Mandate each row ends with a newline
-            } else {
-                row++; 
-                col = 0;
-            } 
+/*
+ * Tree expansion function. Takes a tree with room for MCTS_CHILDREN more
+ * nodes, one of its nodes yet to be expanded, and how many moves the node
+ * is from the root. Gives the node a child for each legal move of the 
+ * tile played there, or for MCTS_CHILDREN of them chosen at random when 
+ * there are more.
+ */
+void expand_mcts_node(Mcts* tree, int node, int ply) {
+    GameState* game = tree->game;
+    Board* board = &(tree->board);
+    Tile* tile = game->tiles[(game->currentTile + ply) % game->numTiles];
+    int moves[MCTS_CHILDREN];
+    long found = 0;
+
+    for (int k = 0; k < tile->rotationCount; k++) {
+        Rotation* rotation = &(tile->rotations[k]);
+        if (rotation->top > rotation->bottom) { //Fits anywhere; try once
+            sample_move(tree, moves, found++, 
+                    encode_search_move(board, k, -2, -2));
+            continue;
         }
-        
-        if (row == (TILE_HEIGHT - 1) && col == TILE_WIDTH) {//Hit last row
-            if (check_tile_end(tileFile)) {
-                tiles[pos] = (Tile*) malloc(sizeof(Tile)); //Make new tile
-                memcpy(tiles[pos++]->tileData, tempTile, sizeof(tempTile));
-                memset(tempTile, 0, sizeof(char) * TILE_HEIGHT * TILE_WIDTH); 
-                row = col = 0; //Put new tile in arr, and clear
-            } else {
-                break;
+        for (int i = -TILE_HEIGHT + 1; i <= board->height; i++) {
+            uint64_t fits[MAX_ROW_WORDS];
+            fit_row(board, rotation, i, fits);
+            for (int w = 0; w < board->rowWords; w++) {
+                for (uint64_t bits = fits[w]; bits != 0; bits &= bits - 1) {
+                    int col = w * WORD_BITS + __builtin_ctzll(bits) - 
+                            BOARD_PAD + TILE_CENTRE;
+                    sample_move(tree, moves, found++, encode_search_move(
+                            board, k, i + TILE_CENTRE, col));
+                }
             }
         }
+    }
+
+    int count = (found < MCTS_CHILDREN) ? (int) found : MCTS_CHILDREN;
+    tree->nodes[node].firstChild = tree->nodeCount;
+    tree->nodes[node].childCount = count;
+    for (int c = 0; c < count; c++) {
+        MctsNode* child = &(tree->nodes[tree->nodeCount++]);
+        child->move = moves[c];
+        child->visits = child->wins = 0;
+        child->firstChild = -1;
+        child->childCount = 0;
+    }
+}
+
+/*
+ * Sampling helper. Takes a tree, the MCTS_CHILDREN moves kept so far, how
+ * many moves have been seen before this one and this move's number, and 
+ * keeps it in place of a random kept move with the chance that leaves 
+ * every move seen equally likely to be kept (reservoir sampling).
+ */
+void sample_move(Mcts* tree, int* moves, long seen, int number) {
+    if (seen < MCTS_CHILDREN) {
+        moves[seen] = number;
+        return;
+    }
+    uint64_t slot = next_random(&(tree->random)) % (uint64_t) (seen + 1);
+    if (slot < MCTS_CHILDREN) {
+        moves[slot] = number;
+    }
+}
+
+/*
+ * Selection function. Takes a tree and one of its expanded nodes with 
+ * children, and returns the child to play: the first never visited, else
+ * the one with the highest UCT score (win rate plus MCTS_EXPLORATION 
+ * times an exploration bonus for rarely visited children).
+ */
+int select_mcts_child(Mcts* tree, int node) {
+    MctsNode* parent = &(tree->nodes[node]);
+    double logVisits = log((double) parent->visits);
+    int best = parent->firstChild;
+    double bestScore = -1.0;
+
+    for (int c = 0; c < parent->childCount; c++) {
+        MctsNode* child = &(tree->nodes[parent->firstChild + c]);
+        if (child->visits == 0) {
+            return parent->firstChild + c;
+        }
+        double score = (double) child->wins / child->visits + 
+                MCTS_EXPLORATION * sqrt(logVisits / child->visits);
+        if (score > bestScore) {
+            bestScore = score;
+            best = parent->firstChild + c;
+        }
+    }
+    return best;
+}
+
+/*
+ * Rollout function. Takes a tree whose board is partway through a playout
+ * and how many moves that is from the root, and plays the game out to the
+ * end with the automatic players' searches: type 1 (starting from a 
+ * random position) or type 2 (starting from a random corner), chosen at 
+ * random for each rollout. Type 1 never tries 270 degrees, so type 2 
+ * checks for a move whenever it finds none. Returns the player (0 or 1)
+ * left without a move.
+ */
+int rollout(Mcts* tree, int ply) {
+    GameState* game = tree->game;
+    Board* board = &(tree->board);
+    Player players[2] = {game->players[0], game->players[1]};
+    int typeOne = next_random(&(tree->random)) & 1;
+
+    for (int p = 0; p < 2; p++) {
+        players[p].lastRow = random_position(tree, board->height);
+        players[p].lastCol = random_position(tree, board->width);
+    }
+
+    while (1) {
+        Tile* tile = game->tiles[(game->currentTile + ply) % game->numTiles];
+        int mover = (game->currentPlayer + ply) % 2;
+        Placement move;
+        int placed = typeOne && auto_play_one(&(players[mover]), 
+                random_position(tree, board->height), 
+                random_position(tree, board->width), tile, board, NULL, 
+                &move);
+        if (!placed && !auto_play_two(&(players[mover]), board, tile, NULL,
+                &move)) {
+            return mover;
+        }
+        ply++;
+    }
+}
+
+/*
+ * Takes a tree and the height (or width) of its board, and returns a 
+ * random row (or column) an automatic player's search may start from.
+ */
+int random_position(Mcts* tree, int size) {
+    return (int) (next_random(&(tree->random)) % (uint64_t) (size + 5)) - 2;
+}
+
+/*
+ * Takes the state of a xorshift generator, advances it and returns the
+ * next pseudo random number.
+ */
+uint64_t next_random(uint64_t* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+/*
+ * Search order setup function. Takes a scan order to fill in, the board 
+ * and tile being searched for, the position the search starts from, and
+ * the direction it moves in (1 forwards, -1 backwards). Sets the order up
+ * to try every angle at one position before the next position, with no 
+ * angles added yet.
+ */
+void init_scan_order(ScanOrder* order, Board* grid, Tile* tile, 
+        int startRow, int startCol, int direction) {
+    long rowLength = grid->width + 5; //Columns -2 to width + 2
+    order->grid = grid;
+    order->tile = tile;
+    order->positions = (grid->height + 5) * rowLength;
+    order->start = (startRow + 2) * rowLength + (startCol + 2);
+    order->direction = direction;
+    order->anglesFirst = 1;
+    order->angleCount = 0;
+    order->total = 0;
+}
+
+/*
+ * Search order function. Takes a scan order and the number of a step in
+ * it, and fills the given placement with the position and angle tried at
+ * that step.
+ */
+void scan_step(ScanOrder* order, long step, Placement* move) {
+    long rowLength = order->grid->width + 5;
+    long position = order->anglesFirst ? step % order->positions : 
+            step / order->angleCount;
+    int angleIndex = order->anglesFirst ? step / order->positions : 
+            step % order->angleCount;
+
+    position = (order->start + order->direction * position + 
+            order->positions) % order->positions; //Wrap around the board
+    move->row = (int) (position / rowLength) - 2;
+    move->col = (int) (position % rowLength) - 2;
+    move->angle = order->angles[angleIndex];
+}
+
+/*
+ * Search function. Takes a scan order and a range of its steps, and finds
+ * the first step in the range at which the tile fits, without changing 
+ * the board. Whole runs of positions are searched a board row at a time
+ * (see scan_positions), so full or crowded parts of the board are passed
+ * over 64 columns at a time; only steps partway through a position's 
+ * angles are tried one by one. Returns the first step at which the tile 
+ * fits, or -1 if none do.
+ */
+long scan_steps(ScanOrder* order, long from, long to) {
+    long step = from;
+    int angleIndex;
+
+    if (order->anglesFirst) { //One run of positions per angle
+        while (step < to) {
+            int angle = (int) (step / order->positions);
+            long first = step % order->positions;
+            long count = (to - step < order->positions - first) ? 
+                    to - step : order->positions - first;
+            long found = scan_positions(order, first, count, angle, 
+                    angle + 1, &angleIndex);
+            if (found >= 0) {
+                return angle * order->positions + found;
+            }
+            step += count;
+        }
+        return -1;
+    }
+
+    for (; step < to && step % order->angleCount != 0; step++) {
+        if (scan_fits(order, step)) {
+            return step; //Finish the position the range starts partway in
+        }
+    }
+    long first = step / order->angleCount;
+    long last = to / order->angleCount; //Positions with all angles in range
+    if (last > first) {
+        long found = scan_positions(order, first, last - first, 0, 
+                order->angleCount, &angleIndex);
+        if (found >= 0) {
+            return found * order->angleCount + angleIndex;
+        }
+        step = last * order->angleCount;
+    }
+    for (; step < to; step++) {
+        if (scan_fits(order, step)) {
+            return step; //Start of the position the range ends partway in
+        }
+    }
+    return -1;
+}
+
+/*
+ * Search helper. Takes a scan order and one of its steps, and returns 1 
+ * if the tile fits at that step, 0 otherwise.
+ */
+int scan_fits(ScanOrder* order, long step) {
+    Placement move;
+    scan_step(order, step, &move);
+    return can_place(move.row, move.col, 
+            tile_rotation(order->tile, move.angle), order->grid);
+}
+
+/*
+ * Search function. Takes a scan order, a run of its positions (the number
+ * of the first, counted from the order's start, and how many there are),
+ * a range of the order's angles and somewhere to store an angle. Works 
+ * through the run a board row at a time, and through each row 64 columns
+ * at a time, finding the columns where each angle fits with fit_word, and
+ * picks out the first position of the run in the order's direction where
+ * any of them does. Returns the number of that position (storing the 
+ * first angle that fits there) or -1 if there is none.
+ */
+long scan_positions(ScanOrder* order, long first, long count, 
+        int angleFrom, int angleTo, int* angleIndex) {
+    Board* grid = order->grid;
+    long rowLength = grid->width + 5;
+    int direction = order->direction;
+    long done = 0;
+
+    while (done < count) {
+        long position = (order->start + direction * (first + done) +
+                order->positions) % order->positions;
+        int row = (int) (position / rowLength) - 2;
+        int col = (int) (position % rowLength) - 2;
+        long span = (direction > 0) ? grid->width + 2 - col + 1 : col + 3;
+        span = (span < count - done) ? span : count - done; //Rest of row
+        int from = col - TILE_CENTRE + BOARD_PAD; //Bits of the first and 
+        int to = from + direction * (int) (span - 1); //last columns
+        int low = (from < to) ? from : to, high = (from < to) ? to : from;
+
+        for (int w = from / WORD_BITS; w >= low / WORD_BITS && 
+                w <= high / WORD_BITS; w += direction) {
+            int lowBit = (w == low / WORD_BITS) ? low % WORD_BITS : 0;
+            int highBit = (w == high / WORD_BITS) ? high % WORD_BITS : 
+                    WORD_BITS - 1;
+            uint64_t range = (~(uint64_t) 0 >> (WORD_BITS - 1 - highBit)) & 
+                    (~(uint64_t) 0 << lowBit);
+            uint64_t fits[ROTATION_COUNT], any = 0;
+            for (int k = angleFrom; k < angleTo; k++) {
+                fits[k] = range & candidate_word(grid, tile_rotation(
+                        order->tile, order->angles[k]), row, w);
+                any |= fits[k];
+            }
+            if (any == 0) {
+                continue;
+            }
+
+            int bit = (direction > 0) ? __builtin_ctzll(any) : 
+                    WORD_BITS - 1 - __builtin_clzll(any);
+            *angleIndex = angleFrom;
+            while (!((fits[*angleIndex] >> bit) & 1)) {
+                (*angleIndex)++; //First angle that fits there
+            }
+            int found = w * WORD_BITS + bit - BOARD_PAD + TILE_CENTRE;
+            return first + done + (found - col) * direction;
+        }
+        done += span;
+    }
+    return -1;
+}
+
+/*
+ * Candidate function. Takes a gameboard, a tile rotation, the board row 
+ * of a move's centre (-2 to height + 2) and a word of a board row, and 
+ * returns that word of the columns whose move fits, as per fit_word: bit
+ * (col - TILE_CENTRE + BOARD_PAD) of the row for a move centred on col. A
+ * rotation with no filled cells fits everywhere.
+ */
+uint64_t candidate_word(Board* grid, Rotation* rotation, int row, int word) {
+    if (rotation->top > rotation->bottom) {
+        return ~(uint64_t) 0;
+    }
+    return fit_word(grid, rotation, row - TILE_CENTRE, word);
+}
+
+/*
+ * Parallel search function. Takes a fully set up scan order, a search 
+ * pool, the player searching and a placement to fill in. Splits the steps
+ * of the order into blocks which the pool's threads (and this one) claim
+ * in order, so that the move found is always the first one in the order,
+ * exactly as a search on one thread would find. Places the tile there.
+ * Returns 1 if a move was found and made, 0 otherwise.
+ */
+int parallel_search(ScanOrder* order, SearchPool* pool, Player* player,
+        Placement* move) {
+    pthread_mutex_lock(&(pool->lock));
+    pool->order = order;
+    pool->nextBlock = 0;
+    pool->best = order->total;
+    pool->trees = NULL;
+    pthread_mutex_unlock(&(pool->lock));
+    run_pool(pool);
+    long best = pool->best;
+
+    if (best == order->total) {
+        return 0; //No matches
+    }
+    scan_step(order, best, move);
+    commit_place(move->row, move->col, tile_rotation(order->tile, 
+            move->angle), order->grid, player);
+    return 1;
+}
+
+/*
+ * Search pool function. Takes a search pool with its next search set up
+ * (a scan order, or trees to grow), and starts the pool's threads on it.
+ * Takes a share of the work on this thread too, and returns once every
+ * thread has finished.
+ */
+void run_pool(SearchPool* pool) {
+    pthread_mutex_lock(&(pool->lock));
+    pool->active = pool->threads;
+    pool->generation++;
+    pthread_cond_broadcast(&(pool->started));
+    pthread_mutex_unlock(&(pool->lock));
+
+    if (pool->trees != NULL) {
+        grow_trees(pool);
+    } else {
+        search_blocks(pool);
+    }
+
+    pthread_mutex_lock(&(pool->lock));
+    while (pool->active > 0) {
+        pthread_cond_wait(&(pool->finished), &(pool->lock));
+    }
+    pthread_mutex_unlock(&(pool->lock));
+}
+
+/*
+ * Search pool function. Takes a search pool with a scan search in 
+ * progress and keeps claiming the next block of steps and searching it,
+ * until the steps run out or every remaining block comes after a step 
+ * already found to fit.
+ */
+void search_blocks(SearchPool* pool) {
+    ScanOrder* order = pool->order;
+
+    while (1) {
+        pthread_mutex_lock(&(pool->lock));
+        long from = pool->nextBlock++ * SEARCH_BLOCK;
+        int done = (from >= order->total || from > pool->best);
+        pthread_mutex_unlock(&(pool->lock));
+        if (done) {
+            return;
+        }
+
+        long to = (from + SEARCH_BLOCK < order->total) ? 
+                from + SEARCH_BLOCK : order->total;
+        long found = scan_steps(order, from, to);
+        if (found >= 0) {
+            pthread_mutex_lock(&(pool->lock));
+            pool->best = (found < pool->best) ? found : pool->best;
+            pthread_mutex_unlock(&(pool->lock));
+        }
+    }
+}
+
+/*
+ * Search pool creation function. Takes the number of threads a search
+ * should be split between, and starts a pool with that many threads,
+ * counting the thread that asks for the search. Returns the pool, or NULL
+ * if only one thread is wanted.
+ */
+SearchPool* create_search_pool(int threads) {
+    if (threads <= 1) {
+        return NULL;
+    }
+
+    SearchPool* pool = (SearchPool*) malloc(sizeof(SearchPool));
+    pool->threads = threads - 1;
+    pool->workers = (pthread_t*) malloc(sizeof(pthread_t) * pool->threads);
+    pool->generation = pool->active = pool->shutdown = 0;
+    pool->trees = NULL;
+    pthread_mutex_init(&(pool->lock), NULL);
+    pthread_cond_init(&(pool->started), NULL);
+    pthread_cond_init(&(pool->finished), NULL);
+
+    for (int i = 0; i < pool->threads; i++) {
+        pthread_create(&(pool->workers[i]), NULL, search_worker, pool);
+    }
+    return pool;
+}
+
+/*
+ * Search pool worker. Takes a search pool (as a void pointer for 
+ * pthread_create), and waits for searches to be started, taking a share
+ * of each one's blocks or trees, until the pool is shut down. Returns 
+ * NULL.
+ */
+void* search_worker(void* arg) {
+    SearchPool* pool = (SearchPool*) arg;
+    int seen = 0;
+
+    while (1) {
+        pthread_mutex_lock(&(pool->lock));
+        while (!pool->shutdown && pool->generation == seen) {
+            pthread_cond_wait(&(pool->started), &(pool->lock));
+        }
+        seen = pool->generation;
+        pthread_mutex_unlock(&(pool->lock));
+        if (pool->shutdown) {
+            return NULL;
+        }
+
+        if (pool->trees != NULL) {
+            grow_trees(pool);
+        } else {
+            search_blocks(pool);
+        }
+        flush_stats();
+
+        pthread_mutex_lock(&(pool->lock));
+        if (--pool->active == 0) {
+            pthread_cond_signal(&(pool->finished));
+        }
+        pthread_mutex_unlock(&(pool->lock));
+    }
+}
+
+/*
+ * Memory function. Takes a search pool (may be NULL), stops its threads 
+ * and frees it.
+ */
+void free_search_pool(SearchPool* pool) {
+    if (pool == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&(pool->lock));
+    pool->shutdown = 1;
+    pthread_cond_broadcast(&(pool->started));
+    pthread_mutex_unlock(&(pool->lock));
+    for (int i = 0; i < pool->threads; i++) {
+        pthread_join(pool->workers[i], NULL);
+    }
+
+    pthread_mutex_destroy(&(pool->lock));
+    pthread_cond_destroy(&(pool->started));
+    pthread_cond_destroy(&(pool->finished));
+    free(pool->workers);
+    free(pool);
+}
+
+/*
+ * Memory function to ensure game over checks don't cause memory issues.
+ * Takes a copy of the gameboard and frees the memory associated with its
+ * occupancy masks. A board in an arena is left for the arena to give back.
+ */
+void free_grid(Board* grid) {
+    free_move_index(grid);
+    free_prefix_counts(grid);
+    if (grid->arena == NULL) {
+        free(grid->planes);
+    }
+    grid->planes = NULL;
+}
+
+/*
+ * Game over check function. Takes the current fitz gameboard, and the 
+ * current tile to be played.
+ * If the board carries a legal move index, reads the tile's legal move
+ * count from it. Otherwise checks every rotation of the tile on every 
+ * point of the board until one fits, without changing the board.
+ * Returns 1 if a valid move exists on the current board, 0
+ * otherwise.
+ */
+int check_game_over(Board* grid, Tile* tile) {
+    COUNT(gameOverChecks, 1);
+    if (grid->index != NULL) {
+        return grid->index->legalCount[tile->shape->id] > 0;
+    }
+
+    int height = grid->height, width = grid->width;
+    COUNT(gameOverScans, 1);
+
+    for (int i = -2; i < height + 2; i++) { //-2 +2 to account for the out
+        for (int j = -2; j < width + 2; j++) { //of bound space
+            COUNT(cellsVisited, 1);
+
+            for (int k = 0; k < tile->rotationCount; k++) { //Each shape
+                if (can_place(i, j, &(tile->rotations[k]), grid)) {
+                    return 1;
+                }
+            }
+        }
+    }
+
+    return 0; //Went through entire grid, no plays found.
+}
+
+
+/*
+ * Placement function. Takes the row and column of the attempted move,
+ * the rotation of the tile to be played, the current gameboard, and the 
+ * player making a move.
+ * Tries to place the tile on the designated board coordinates.
+ * If successful, returns 1. Else, returns 0.
+ */
+int attempt_place(int row, int col, Rotation* rotation, Board* grid, 
+        Player* player) {
+    if (!can_place(row, col, rotation, grid)) {
+        return 0;
+    }
+
+    commit_place(row, col, rotation, grid, player);
+    return 1;
+}
+
+/*
+ * Placement check function. Takes the row and column of a move, the 
+ * rotation of the tile to be played, and the current gameboard. Tests 
+ * whether the tile could be placed there, without changing the board. If 
+ * the board keeps prefix counts, most moves that don't fit are turned 
+ * down by them before the tile's cells are checked.
+ * Returns 1 if it could, 0 otherwise.
+ */
+int can_place(int row, int col, Rotation* rotation, Board* grid) {
+    COUNT(probes, 1);
+    if (row < -2 || col < -2 || row > grid->height + 2 || 
+            col > grid->width + 2) {
+        COUNT(outOfBounds, 1);
+        return 0; //Invalid, placement will cause entire tile to be off board
+    }
+
+    if (grid->prefix != NULL && !enough_free(grid, rotation, 
+            row - TILE_CENTRE, col - TILE_CENTRE)) {
+        COUNT(prefixRejects, 1);
+        return 0; //Too few empty cells under some row of the tile
+    }
+
+    //Catches collisions with played cells and the wall around the board
+    if (!tile_fits(grid, rotation, row - TILE_CENTRE, col - TILE_CENTRE)) {
+        COUNT(collisions, 1);
+        return 0;
+    }
+    return 1;
+}
+
+/*
+ * Commit function. Takes the row and column of a move already checked 
+ * with can_place, the rotation of the tile played, the current gameboard
+ * and the player making the move. Writes the tile into the board and 
+ * brings the legal move index up to date.
+ */
+void commit_place(int row, int col, Rotation* rotation, Board* grid, 
+        Player* player) {
+    int rowOffset = row - TILE_CENTRE; //Create transposed coordinates
+    int colOffset = col - TILE_CENTRE; //Based from the centre of the tile
+    int plane = icon_plane(player->icon);
+
+    for (int i = rotation->top; i <= rotation->bottom; i++) {
+        unsigned int bits = (rotation->mask >> (i * TILE_WIDTH)) & 
+                TILE_ROW_MASK;
+        board_stamp(grid, OCCUPIED_PLANE, i + rowOffset, colOffset, bits);
+        if (plane != OCCUPIED_PLANE) {
+            board_stamp(grid, plane, i + rowOffset, colOffset, bits);
+        }
+    }
+
+    if (grid->index != NULL) { //Only the touched region can lose moves
+        update_move_index(grid, rotation, rowOffset, colOffset);
+    }
+    if (grid->prefix != NULL) {
+        update_prefix_counts(grid, rowOffset + rotation->top, 
+                rowOffset + rotation->bottom);
+    }
+}
+
+/*
+ * Fit check function. Takes a gameboard, a tile rotation, and the board
+ * coordinates of the tile's top left corner (which must be no more than
+ * 4 cells off the board). Tests the tile against the occupancy mask 
+ * beneath it; the wall around the board makes this catch off board cells
+ * as well as played ones. Uses the widest vector kernel fitz was built 
+ * for (AVX2, then SSE2), else the scalar one.
+ * Returns 1 if the tile fits, 0 otherwise.
+ */
+int tile_fits(Board* grid, Rotation* rotation, int rowOffset, 
+        int colOffset) {
+#if defined(__AVX2__)
+    return tile_fits_avx2(grid, rotation, rowOffset, colOffset);
+#elif defined(__SSE2__)
+    return tile_fits_sse2(grid, rotation, rowOffset, colOffset);
+#else
+    return tile_fits_scalar(grid, rotation, rowOffset, colOffset);
+#endif
+}
+
+#if defined(__AVX2__)
+/*
+ * AVX2 fit check kernel, as per tile_fits. Shifts tile rows 0-3 into 
+ * place against the two board words under each of them in one 256 bit
+ * register, and does row 4 in a 128 bit register. Shifts of 64 or more
+ * give 0, so tiles which don't reach the second word need no branch.
+ */
+int tile_fits_avx2(Board* grid, Rotation* rotation, int rowOffset, 
+        int colOffset) {
+    int pos = colOffset + BOARD_PAD, stride = grid->rowWords;
+    uint64_t* base = board_row(grid, OCCUPIED_PLANE, rowOffset) + 
+            pos / WORD_BITS;
+    __m128i shiftLow = _mm_cvtsi32_si128(pos % WORD_BITS);
+    __m128i shiftHigh = _mm_cvtsi32_si128(WORD_BITS - pos % WORD_BITS);
+
+    __m256i rows = _mm256_loadu_si256((__m256i*) rotation->rows);
+    __m256i low = _mm256_set_epi64x(base[3 * stride], base[2 * stride], 
+            base[stride], base[0]);
+    __m256i high = _mm256_set_epi64x(base[3 * stride + 1], 
+            base[2 * stride + 1], base[stride + 1], base[1]);
+    __m256i hits = _mm256_or_si256(
+            _mm256_and_si256(low, _mm256_sll_epi64(rows, shiftLow)),
+            _mm256_and_si256(high, _mm256_srl_epi64(rows, shiftHigh)));
+
+    __m128i lastRow = _mm_cvtsi64_si128((long long) rotation->rows[4]);
+    __m128i lastHits = _mm_or_si128(
+            _mm_and_si128(_mm_cvtsi64_si128(base[4 * stride]), 
+            _mm_sll_epi64(lastRow, shiftLow)),
+            _mm_and_si128(_mm_cvtsi64_si128(base[4 * stride + 1]), 
+            _mm_srl_epi64(lastRow, shiftHigh)));
+    hits = _mm256_or_si256(hits, _mm256_castsi128_si256(lastHits));
+    return _mm256_testz_si256(hits, hits);
+}
+#elif defined(__SSE2__)
+/*
+ * SSE2 fit check kernel, as per tile_fits. Shifts tile rows into place 
+ * two at a time against the two board words under each of them. Shifts 
+ * of 64 or more give 0, so tiles which don't reach the second word need
+ * no branch.
+ */
+int tile_fits_sse2(Board* grid, Rotation* rotation, int rowOffset, 
+        int colOffset) {
+    int pos = colOffset + BOARD_PAD, stride = grid->rowWords;
+    uint64_t* base = board_row(grid, OCCUPIED_PLANE, rowOffset) + 
+            pos / WORD_BITS;
+    __m128i shiftLow = _mm_cvtsi32_si128(pos % WORD_BITS);
+    __m128i shiftHigh = _mm_cvtsi32_si128(WORD_BITS - pos % WORD_BITS);
+    __m128i hits = _mm_setzero_si128();
+
+    for (int i = 0; i < TILE_HEIGHT; i += 2) { //Row 5 is empty padding
+        uint64_t* next = (i + 1 < TILE_HEIGHT) ? base + stride : base;
+        __m128i rows = _mm_loadu_si128((__m128i*) (rotation->rows + i));
+        __m128i low = _mm_set_epi64x((long long) next[0], 
+                (long long) base[0]);
+        __m128i high = _mm_set_epi64x((long long) next[1], 
+                (long long) base[1]);
+        hits = _mm_or_si128(hits, _mm_or_si128(
+                _mm_and_si128(low, _mm_sll_epi64(rows, shiftLow)),
+                _mm_and_si128(high, _mm_srl_epi64(rows, shiftHigh))));
+        base += 2 * stride;
+    }
+    hits = _mm_cmpeq_epi8(hits, _mm_setzero_si128());
+    return _mm_movemask_epi8(hits) == 0xFFFF;
+}
+#endif
+
+/*
+ * Scalar fit check kernel, as per tile_fits. Tests every filled tile row 
+ * against the occupancy mask beneath it, one row at a time.
+ */
+int tile_fits_scalar(Board* grid, Rotation* rotation, int rowOffset, 
+        int colOffset) {
+    for (int i = rotation->top; i <= rotation->bottom; i++) {
+        unsigned int bits = (rotation->mask >> (i * TILE_WIDTH)) & 
+                TILE_ROW_MASK;
+        if (bits & board_window(grid, OCCUPIED_PLANE, i + rowOffset,
+                colOffset)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*
+ * Input check function for h players. Takes pointers to the attempted 
+ * row and col, a pointer to the attempted rotation angle, and the current
+ * game (for saving, and to flag the end of input).
+ * Tries to read from stdin into a string. If successful, tries to validate 
+ * the data retrieved as per the specification. If successful, returns 1. 
+ * Else, returns 0 if any of these checks fail.
+ */
+int check_user_input(int* row, int* col, int* rotateAngle, 
+        GameState* game) {
+    char* userInput;
+    int valid = read_stdin(&userInput, game);
+
+    if (!valid) {
+        return 0; //Read failed somehow but it wasnt exit worthy
+    }
+
+    valid = validate_inputs(row, col, rotateAngle, &userInput);
+
+    if (!valid) {
+        return 0; //Numbers weren't valid
+    }
+
+    return 1;
+}
+
+/*
+ * Helper function. Clears stdin in the event of too much data inputted
+ * to fitz to ensure further plays are not affected by the overflow.
+ */
+void clear_stdin(void) {
+    char voidArr[MAX_INPUT]; //Used to dump anything in stdin
+    char* stringHolder;
+    
+    do {
+        stringHolder = fgets(voidArr, sizeof(voidArr), stdin);
+        //Throw all the data still in stdin into the abyss, until we hit
+        //new line or there is nothing left.
+    } while (stringHolder != NULL && (strchr(voidArr, '\n') == NULL));
+}
+
+/*
+ * Input function. Takes a pointer to the string to be read, and the 
+ * current game (for saving, and to flag the end of input).
+ * Points the string at the game's input buffer (allocated from the game's
+ * arena on the first prompt, as per spec), and tries to read into it. If 
+ * data overflows the buffer provided, clears stdin to ensure an empty 
+ * stdin.
+ *
+ * Once data collected, if of valid size, attempts to clean
+ * it. If data is of valid size and clean as per the specification,
+ * return 1. In all other cases, return 0. If EOF detected and no other 
+ * data present, the game's status flag is set to 10 (end of input). If 
+ * save present in collected string, attempts to save.
+ */
+int read_stdin(char** userInput, GameState* game) {
+    if (game->input == NULL) { //+2 to account for \0 and overflow data
+        game->input = (char*) arena_alloc(&(game->arena), sizeof(char) * 
+                (MAX_INPUT + 2));
+    }
+    *userInput = game->input;
+
+    if (fgets(*userInput, (MAX_INPUT + 2), stdin) != NULL) { 
+        char* newlinePos = strchr(*userInput, '\n');
+        if (newlinePos != NULL) {
+            *newlinePos = '\0';
+        } else { //No newline in string; EOF input or overflowed data
+            if (strlen(*userInput) == 71) { //Data read in was too big
+                if (!feof(stdin)) { //If this is true, means theres still data
+                    clear_stdin(); //in stdin
+                    return 0;
+                } else { //Else there is nothing left in the pipe, 
+                    return 0; //Yet we still overflowed
+                }
+            } //If the length isn't 71 is must be lower; therefore, valid 
+            printf("\n"); //If it's EOF include a newline
+        } 
+    } else {
+        game->flag.returnVal = END_OF_INPUT; //EOF with no data
+        return 0;
+    }
+
+    if (!(strncmp(*userInput, "save", 4))) { //Check if we have a save attempt
+        attempt_save(game, userInput);
+        return 0; //Used to reprompt later for valid move
+    }
+
+    if (clean_inputs(userInput)) { //Check if valid data
+        return 1;
+    } else {
+        return 0;
+    }
+}
+
+/*
+ * Saving function. Takes the current game, and a user defined string 
+ * from stdin. 
+ * Attempts to save to the filepath specified in user defined string.
+ * If file cannot be reached, return, else write to file with
+ * current game data as per specificed format.
+ */
+void attempt_save(GameState* game, char** userInput) {
+    char saveFilePath[MAX_INPUT];
+    strncpy(saveFilePath, (*userInput + 4), MAX_INPUT - 1); //Ignore "save"
+    saveFilePath[MAX_INPUT - 1] = '\0';
+    FILE* writeLocation = fopen(saveFilePath, "w");
+    if (writeLocation == NULL) {
+        fprintf(stderr, "Unable to save game\n");
+        return; //Can't save
+    } else if (game->saveFormat != TEXT_SAVE) {
+        save_binary(game, writeLocation, (game->saveFormat == RLE_SAVE) ? 
+                RLE_BOARD : PACKED_BOARD);
+    } else {
+        fprintf(writeLocation, "%d %d %d %d\n", game->currentTile,
+                game->currentPlayer, game->grid.height, game->grid.width);
+
+        for (int i = 0; i < game->grid.height; i++) {
+            for (int j = 0; j < game->grid.width; j++) {
+                fprintf(writeLocation, "%c", get_cell(&(game->grid), i, j));
+            }
+            fprintf(writeLocation, "\n");
+        }
+    }
+
+    COUNT(saveBytes, ftell(writeLocation));
+    fclose(writeLocation);
+}
+
+/*
+ * Saving function. Takes the current game, a save file open for writing 
+ * and a board encoding, and writes the game to it in the binary save 
+ * format:
+ *      -  Magic "FITZ", version (1) and board encoding bytes
+ *      -  Next player byte and a zero byte
+ *      -  Next tile (4 bytes), height and width (2 bytes each)
+ *      -  Board, in the given encoding (see pack_board and encode_runs)
+ *      -  FNV-1a checksum of everything before it (4 bytes)
+ * All numbers are little endian. Builds the file in the game's arena and
+ * writes it in one go.
+ */
+void save_binary(GameState* game, FILE* saveFile, int encoding) {
+    Board* grid = &(game->grid);
+    size_t packedSize = (grid->width + 3) / 4 * grid->height;
+    size_t cells = (size_t) grid->height * grid->width; //Most runs can take
+    ArenaMark mark = arena_mark(&(game->arena));
+    unsigned char* data = (unsigned char*) arena_calloc(&(game->arena), 
+            BINARY_HEADER + ((encoding == RLE_BOARD) ? cells : packedSize) + 
+            CHECKSUM_BYTES, 1);
+    unsigned char* out;
+
+    memcpy(data, BINARY_MAGIC, 4);
+    data[4] = BINARY_VERSION;
+    data[5] = (unsigned char) encoding;
+    data[6] = (unsigned char) game->currentPlayer;
+    for (int i = 0; i < 4; i++) {
+        data[8 + i] = (unsigned char) (game->currentTile >> (8 * i));
+    }
+    data[12] = grid->height & 0xFF;
+    data[13] = grid->height >> 8;
+    data[14] = grid->width & 0xFF;
+    data[15] = grid->width >> 8;
+
+    if (encoding == RLE_BOARD) {
+        out = encode_runs(grid, data + BINARY_HEADER);
+    } else {
+        out = pack_board(grid, data + BINARY_HEADER);
+    }
+
+    uint32_t sum = checksum(FNV_OFFSET, data, out - data);
+    for (int i = 0; i < CHECKSUM_BYTES; i++) {
+        *out++ = (unsigned char) (sum >> (8 * i));
+    }
+    fwrite(data, 1, out - data, saveFile);
+    arena_release(&(game->arena), mark);
+}
+
+/*
+ * Encoding function. Takes a gameboard and where to write it, and writes
+ * each row packed 2 bits per cell ('.' 0, '*' 1, '#' 2), 4 cells to a 
+ * byte from the low bits up, padded to a whole byte. Returns the end of 
+ * what was written.
+ */
+unsigned char* pack_board(Board* grid, unsigned char* out) {
+    for (int i = 0; i < grid->height; i++) {
+        for (int j = 0; j < grid->width; j += WORD_BITS) {
+            uint64_t stars = row_cells(grid, icon_plane('*'), i, j);
+            uint64_t hashes = row_cells(grid, icon_plane('#'), i, j);
+            for (int k = j; k < grid->width && k < j + WORD_BITS; k += 4) {
+                *out++ = spread_bits(stars & 0xF) | 
+                        (spread_bits(hashes & 0xF) << 1);
+                stars >>= 4;
+                hashes >>= 4;
+            }
+        }
+    }
+    return out;
+}
+
+/*
+ * Encoding function. Takes a gameboard and where to write it, and writes
+ * the board's cells, row after row, as runs of the same cell. Each run is
+ * written by put_run and runs carry on from one row to the next. Returns 
+ * the end of what was written, which is never more than one byte a cell.
+ */
+unsigned char* encode_runs(Board* grid, unsigned char* out) {
+    int code = 0;
+    long length = 0;
+
+    for (int i = 0; i < grid->height; i++) {
+        for (int j = 0; j < grid->width; j += WORD_BITS) {
+            uint64_t stars = row_cells(grid, icon_plane('*'), i, j);
+            uint64_t hashes = row_cells(grid, icon_plane('#'), i, j);
+            for (int k = j; k < grid->width && k < j + WORD_BITS; k++) {
+                int cell = (int) ((stars & 1) | ((hashes & 1) << 1));
+                if (cell != code && length > 0) {
+                    out = put_run(out, code, length);
+                    length = 0;
+                }
+                code = cell;
+                length++;
+                stars >>= 1;
+                hashes >>= 1;
+            }
+        }
+    }
+    return put_run(out, code, length);
+}
+
+/*
+ * Encoding helper. Takes where to write, a cell code and a run length, and
+ * writes (length - 1) << 2 | code as a little endian base 128 number: 7 
+ * bits a byte, with the top bit set on every byte but the last. Returns
+ * the end of what was written.
+ */
+unsigned char* put_run(unsigned char* out, int code, long length) {
+    unsigned long value = ((unsigned long) (length - 1) << RUN_CODE_BITS) | 
+            code;
+    while (value >= 0x80) {
+        *out++ = (unsigned char) (value | 0x80);
+        value >>= 7;
+    }
+    *out++ = (unsigned char) value;
+    return out;
+}
+
+/*
+ * Bitboard helper. Takes a board, a player plane, and a row and column on
+ * the board, and returns that player's cells from the column on as a mask
+ * of up to 64 cells (cells past the edge of the board are never set).
+ */
+uint64_t row_cells(Board* grid, int plane, int row, int col) {
+    uint64_t* rowBits = board_row(grid, plane, row);
+    int pos = col + BOARD_PAD;
+    int word = pos / WORD_BITS, bit = pos % WORD_BITS;
+    uint64_t cells = rowBits[word] >> bit;
+
+    if (bit != 0) {
+        cells |= rowBits[word + 1] << (WORD_BITS - bit);
+    }
+    return cells;
+}
+
+/*
+ * Packing helper. Takes 4 bits and spreads them out to every other bit of
+ * a byte, starting from bit 0.
+ */
+unsigned int spread_bits(unsigned int bits) {
+    return (bits & 1) | ((bits & 2) << 1) | ((bits & 4) << 2) | 
+            ((bits & 8) << 3);
+}
+
+/*
+ * Packing helper. Takes a byte and gathers every other bit of it, starting
+ * from bit 0, into 4 bits. Undoes spread_bits.
+ */
+unsigned int gather_bits(unsigned int bits) {
+    return (bits & 1) | ((bits >> 1) & 2) | ((bits >> 2) & 4) | 
+            ((bits >> 3) & 8);
+}
+
+/*
+ * Takes a 32 bit FNV-1a hash (FNV_OFFSET to start a new one), a block of 
+ * data and its size, and returns the hash carried on over the data. Used
+ * to check binary saves.
+ */
+uint32_t checksum(uint32_t hash, const unsigned char* data, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ data[i]) * FNV_PRIME;
+    }
+    return hash;
+}
+
+/*
+ * Cleaning function. Takes user generated string from stdin
+ * and checks it is valid as per specification requirements.
+ * If data is valid, return 1, else return 0 in all other cases.
+ */
+int clean_inputs(char** userInput) {
+    char c, prevData = ' ';
+    int numSpaces = 0, index = 0;
+
+    do {
+        c = (*userInput)[index++]; 
+    
+        if (c == '\0') { //Hit end of string
+            break;
+        }
+
+        if (c == ' ') {
+            if (prevData == ' ') { //If this returns 1, two spaces
+                return 0; //Also catches leading space
+            } else {
+                if (++numSpaces > 2) { //This signifies the end of an int
+                    return 0; //Too many numbers given 
+                }
+            } 
+        } else if (c == '+' || c == '-') { //Only let +/- appear
+            if (prevData != ' ') { //Ensure no sign appears after digits
+                return 0;
+            } else {
+                continue;
+            }
+        } else if (!isdigit(c)) { 
+            return 0; //Not a number
+            
+        } 
+        prevData = (char) c;
+    } while (c != '\0');
+
+    if (numSpaces != 2) { //Was there more than 2 spaces? 2 spaces == 3 ints
+        return 0; //As no trailing spaces
+    }
+    return 1;
+}
+
+/*
+ * Validation function. Takes pointers to the current row and column to be
+ * played, a pointer to the current angle to be played, as well as a
+ * cleaned user defined string from stdin.
+ * Attempts to convert the string contents to values. Checks values
+ * meet specification criteria regarding validity. If valid, reutrns 1,
+ * else returns 0. 
+ * Note: board size checks handled by attempted place
+ * */
+int validate_inputs(int* row, int* col, int* rotateAngle, char** userInput) {
+    char* currentInt = *userInput;
+    int index = 0, angle = 0;
+    int inputs[3]; //String precleaned to have 3 ints 
+
+    while (*currentInt != '\0') {
+        if (isdigit(*currentInt) || ((currentInt[0] == '+' || 
+                currentInt[0] == '-') && isdigit(currentInt[1]))) { //neg/pos
+            inputs[index++] = strtol(currentInt, &currentInt, 10);
+        } else {
+            currentInt++;
+        }
+    }
+
+    angle = inputs[2]; //used for clarity
+
+    if (angle != 0 && angle != 90 && angle != 180 && angle != 270) {
+        return 0;
+    } else {
+        *row = inputs[0]; //These will be checked for validity at placement
+        *col = inputs[1];
+        *rotateAngle = inputs[2];
+    }
+
+    return 1;
+}
+
+/*
+ * Printing function. Takes a tile to be printed, and prints it to 
+ * stdout.
+ */
+void print_tile(Tile* tile) {
+    for (int i = 0; i < TILE_WIDTH; i++) {
+        for (int j = 0; j < TILE_HEIGHT; j++) {
+            printf("%c", tile->tileData[i][j]);
+        }
+        printf("\n");
+    }
+}
+
+/*
+ * Loading function. Takes a file pointer, a status flag struct,
+ * a filepath, and a pointer to the number of tiles fitz has.
+ *
+ * Attempts to read from given file to construct the tiles 
+ * fitz will use for the current game. If any invalid data is 
+ * encountered, as per the specification, fitz will exit with
+ * relevant exit status. Otherwise, upon successful reading
+ * and processing, return an array of filled Tile structs for use
+ * in fitz. Regular files are mapped into memory and checked a whole tile
+ * at a time; anything else (e.g. a pipe) is read through the file pointer.
+ * Either way the tiles are held in one block, freed with free_tiles.
+ */
+Tile** load_tiles(FILE** tileFile, DataReadFlag* loadFlag, char* tileName, 
+        int* numTiles) { 
+    struct stat info;
+    int fd = open(tileName, O_RDONLY);
+    if (fd == -1) {
+        loadFlag->returnVal = INVALID_TILEFILE;
+        check_load_errors(*loadFlag);
+    }
+
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        char* data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            close(fd);
+            Tile** tiles = load_mapped_tiles(data, info.st_size, loadFlag, 
+                    numTiles);
+            munmap(data, info.st_size);
+            return tiles;
+        }
+    }
+    close(fd);
+
+    int tileCount = 1; //Assume one tile in file; if not, will error later
+    Tile* block = (Tile*) malloc(sizeof(Tile) * tileCount);
+    int pos = 0, col = 0, row = 0, point = 0;
+    char tempTile[TILE_HEIGHT][TILE_WIDTH]; //tiles are a fixed size
+
+    *tileFile = open_file(tileName, loadFlag, TILE_FILE);
+
+    while (point != EOF) {
+
+        point = fgetc(*tileFile); //grab each char in file
+        if(!check_point(point, loadFlag)) { //Check it's valid (,!\n)
+            break;
+        }
+
+        tempTile[row][col++] = (char) point; //Put char in, incr column
+
+        if (col == TILE_WIDTH && row != (TILE_HEIGHT - 1)) { //Hit end of row
+            if(!check_row_end(tileFile)) { //Grabs next char
+                break; //Mandate each row ends with a newline
+            } else {
+                row++; 
+                col = 0;
+            } 
+        }
+        
+        if (row == (TILE_HEIGHT - 1) && col == TILE_WIDTH) {//Hit last row
+            if (check_tile_end(tileFile)) {
+                memcpy(block[pos].tileData, tempTile, sizeof(tempTile));
+                block[pos].id = pos;
+                build_rotations(&block[pos++]); //Rotation table for play
+                memset(tempTile, 0, sizeof(char) * TILE_HEIGHT * TILE_WIDTH); 
+                row = col = 0; //Put new tile in arr, and clear
+            } else {
+                break;
+            }
+        }
+
+        if (pos == tileCount) { //Memory buffer
+            tileCount *= 2; //Double # of tiles
+            block = realloc(block, sizeof(Tile) * tileCount);
+        }
+    }
+
+    check_tile_contents(loadFlag, pos, col, row);
+    *numTiles = pos; //# of tiles in the block
+    fclose(*tileFile);
+    *tileFile = NULL; //Dont let this dangle in case we need to load save
+    return index_tiles(block, pos);
+}
+
+/*
+ * Loading function. Takes the contents of a tile file mapped into memory
+ * and their size, a status flag struct, and somewhere to store the number
+ * of tiles. Every tile is a fixed TILE_RECORD bytes followed by a blank 
+ * line (or the end of the file), so each is checked in one go and copied 
+ * straight into a block sized for the whole file. Exits fitz with the 
+ * same status load_tiles would if the contents are invalid.
+ */
+Tile** load_mapped_tiles(char* data, size_t size, DataReadFlag* loadFlag,
+        int* numTiles) {
+    Tile* block = (Tile*) malloc(sizeof(Tile) * (size / TILE_RECORD));
+    size_t offset = 0;
+    int pos = 0;
+
+    while (offset < size) {
+        const char* record = data + offset;
+        if (size - offset < TILE_RECORD || !check_tile_record(record) ||
+                (size - offset > TILE_RECORD && record[TILE_RECORD] != '\n')) {
+            free(block);
+            loadFlag->returnVal = INVALID_TILE_CONTENTS;
+            check_load_errors(*loadFlag);
+        }
+        for (int row = 0; row < TILE_HEIGHT; row++) {
+            memcpy(block[pos].tileData[row], record + row * (TILE_WIDTH + 1),
+                    TILE_WIDTH);
+        }
+        block[pos].id = pos;
+        build_rotations(&block[pos++]);
+        offset += TILE_RECORD + 1; //Blank line between tiles
+    }
+
+    *numTiles = pos;
+    return index_tiles(block, pos);
+}
+
+/*
+ * Validation function. Takes the TILE_RECORD bytes making up one tile in
+ * a tile file, and checks every cell is a valid tile char (,!\n) and every
+ * row ends with a newline. Cells are checked 16 at a time where fitz was 
+ * built with SSE2, using two overlapping loads that stay inside the tile.
+ * Returns 1 if the tile is valid, 0 otherwise.
+ */
+int check_tile_record(const char* record) {
+#if defined(__SSE2__)
+    uint32_t valid = 0xFFFFu;
+    for (int start = 0; start <= TILE_RECORD - 16; 
+            start += TILE_RECORD - 16) {
+        __m128i chunk = _mm_loadu_si128((__m128i*) (record + start));
+        __m128i cells = _mm_or_si128(
+                _mm_cmpeq_epi8(chunk, _mm_set1_epi8(',')),
+                _mm_cmpeq_epi8(chunk, _mm_set1_epi8('!')));
+        cells = _mm_or_si128(cells, 
+                _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\n')));
+        valid &= (uint32_t) _mm_movemask_epi8(cells);
+    }
+    if (valid != 0xFFFFu) {
+        return 0;
+    }
+#else
+    for (int i = 0; i < TILE_RECORD; i++) {
+        if (record[i] != ',' && record[i] != '!' && record[i] != '\n') {
+            return 0;
+        }
+    }
+#endif
+    for (int row = 1; row <= TILE_HEIGHT; row++) {
+        if (record[row * (TILE_WIDTH + 1) - 1] != '\n') { //Mandate newline
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*
+ * Takes a block of loaded tiles and the number of them, gives each tile
+ * its canonical shape, and returns an array pointing at each tile in the
+ * block, as the rest of fitz expects.
+ */
+Tile** index_tiles(Tile* block, int numTiles) {
+    intern_shapes(block, numTiles);
+    Tile** tiles = (Tile**) malloc(sizeof(Tile*) * numTiles);
+    for (int i = 0; i < numTiles; i++) {
+        tiles[i] = &block[i];
+    }
+    return tiles;
+}
+
+/*
+ * Shape interning function. Takes a block of loaded tiles and the number
+ * of them, and points every tile at its canonical shape. Tiles which are 
+ * the same up to rotation and translation are given the same shape, found
+ * through a hash table keyed on the canonical mask. The shapes are held 
+ * in one block in order of their number, starting with the first tile's.
+ */
+void intern_shapes(Tile* block, int numTiles) {
+    int tableSize = 1;
+    while (tableSize < 2 * numTiles) { //Keep the table at most half full
+        tableSize *= 2;
+    }
+    int* table = (int*) calloc(tableSize, sizeof(int)); //Shape number + 1
+    int* shapeOf = (int*) malloc(sizeof(int) * numTiles);
+    int shapeCount = 1, numShapes = 0;
+    Shape* shapes = (Shape*) malloc(sizeof(Shape) * shapeCount);
+
+    for (int t = 0; t < numTiles; t++) {
+        Shape candidate;
+        canonical_shape(&block[t], &candidate);
+        uint32_t hash = candidate.mask * SHAPE_HASH;
+        int slot = (hash ^ (hash >> 16)) & (tableSize - 1);
+        while (table[slot] && shapes[table[slot] - 1].mask != 
+                candidate.mask) {
+            slot = (slot + 1) & (tableSize - 1); //Linear probing
+        }
+
+        if (!table[slot]) { //First tile with this shape
+            if (numShapes == shapeCount) {
+                shapeCount *= 2;
+                shapes = realloc(shapes, sizeof(Shape) * shapeCount);
+            }
+            candidate.id = numShapes;
+            shapes[numShapes++] = candidate;
+            table[slot] = numShapes;
+        }
+        shapeOf[t] = table[slot] - 1;
+    }
+
+    for (int t = 0; t < numTiles; t++) { //Block has stopped moving
+        block[t].shape = &shapes[shapeOf[t]];
+    }
+    free(shapeOf);
+    free(table);
+}
+
+/*
+ * Shape helper. Takes a tile with its rotation table built, and fills in
+ * the tile's shape: its distinct rotations moved to the top left corner,
+ * and the smallest of their masks as the canonical mask.
+ */
+void canonical_shape(Tile* tile, Shape* shape) {
+    shape->rotationCount = 0;
+    for (int k = 0; k < tile->rotationCount; k++) {
+        Rotation normal;
+        normalise_rotation(&(tile->rotations[k]), &normal);
+        int repeat = 0;
+        for (int r = 0; r < shape->rotationCount; r++) { //Symmetric repeat?
+            repeat |= shape->rotations[r].mask == normal.mask;
+        }
+        if (repeat) {
+            continue;
+        }
+        if (shape->rotationCount == 0 || normal.mask < shape->mask) {
+            shape->mask = normal.mask;
+        }
+        shape->rotations[shape->rotationCount++] = normal;
+    }
+}
+
+/*
+ * Shape helper. Takes a rotation table entry and fills a second entry with
+ * the same cells moved up and left until their bounding box starts at the
+ * top left corner of the tile. Entries with no filled cells are copied.
+ */
+void normalise_rotation(Rotation* rotation, Rotation* normal) {
+    *normal = *rotation;
+    if (rotation->top > rotation->bottom) {
+        return; //Nothing to move
+    }
+
+    normal->mask = 0;
+    memset(normal->rows, 0, sizeof(normal->rows));
+    for (int i = rotation->top; i <= rotation->bottom; i++) {
+        uint64_t row = rotation->rows[i] >> rotation->left;
+        normal->rows[i - rotation->top] = row;
+        normal->mask |= (uint32_t) row << ((i - rotation->top) * TILE_WIDTH);
+    }
+    normal->top = normal->left = 0;
+    normal->bottom = rotation->bottom - rotation->top;
+    normal->right = rotation->right - rotation->left;
+}
+
+/*
+ * Freeing function. Takes the tiles returned by load_tiles and frees 
+ * them along with the blocks holding them and their shapes.
+ */
+void free_tiles(Tile** tiles) {
+    free(tiles[0]->shape); //First tile has shape 0, at the block's start
+    free(tiles[0]);
+    free(tiles);
+}
+
+/*
+ * Printing function. Takes an array of filled Tile structs, and the 
+ * number of tiles read in by fitz. 
+ * For every tile in the array, print it alongside its three
+ * rotated forms to stdout.
+ */
+void print_rotations(Tile** tiles, int numTiles) {
+    Tile rotatedTiles[numTiles][ROTATION_COUNT]; //4 rotations of 90 possible
+    
+    for (int i = 0; i < numTiles; i++) {
+        rotatedTiles[i][0] = *tiles[i]; //First tile needs no rotation
+        for (int j = 1; j < ROTATION_COUNT; j++) {
+            rotatedTiles[i][j] = rotate_tile(tiles[i], j); 
+        }
+    }
+
+    print_tile_rotations(numTiles, rotatedTiles);
+}
+
+/*
+ * Rotation function. Takes a tile to be rotated and a specified number
+ * of rotations. Rotates the tile by this number of rotations
+ * in increments of 90 degrees, and returns the rotated tile.
+ */
+Tile rotate_tile(Tile* tileStart, int numRotations) { 
+    char tileCopy[TILE_HEIGHT][TILE_WIDTH];
+    char tile[TILE_HEIGHT][TILE_WIDTH];
+    COUNT(rotations, 1);
+    if (numRotations == 0) {
+        return *tileStart;
+    }
+    memcpy(tile, tileStart->tileData, sizeof(tile)); //Load tileData into mem
+    for (int i = 0; i < numRotations; i++) {
+        for (int j = 0; j < TILE_HEIGHT; j++) {
+            for (int k = 0; k < TILE_WIDTH; k++) {
+                tileCopy[j][k] = tile[k][j]; //Swap rows/cols
+            }
+        }
+    
+        for (int j = 0; j < TILE_HEIGHT; j++) {
+            for (int k = 0; k < TILE_WIDTH / 2; k++) { //Mirror grid
+                char tmp = tileCopy[j][k]; //Minus 1 for 0 based index
+                tileCopy[j][k] = tileCopy[j][(TILE_WIDTH - 1) - k]; 
+                tileCopy[j][(TILE_WIDTH - 1) - k] = tmp; 
+            }
+        }
+        memcpy(tile, tileCopy, sizeof(tileCopy)); //Allows further rotations
+    }
+    Tile rotatedTile;
+    memcpy(rotatedTile.tileData, tileCopy, sizeof(tileCopy));
+    return rotatedTile;
+} 
+
+/*
+ * Rotation table function. Takes a freshly loaded tile and builds its
+ * rotation table, storing each distinct rotation once as a packed mask
+ * and pointing every 90 degree step at the matching entry.
+ */
+void build_rotations(Tile* tile) {
+    tile->rotationCount = 0;
+    for (int k = 0; k < ROTATION_COUNT; k++) {
+        Tile rotated = rotate_tile(tile, k);
+        Rotation candidate;
+        set_rotation(&candidate, &rotated, k * ROTATION_STEP);
+        tile->rotationOf[k] = tile->rotationCount;
+
+        for (int r = 0; r < tile->rotationCount; r++) { //Symmetric repeat?
+            if (tile->rotations[r].mask == candidate.mask) {
+                tile->rotationOf[k] = r;
+                break;
+            }
+        }
+
+        if (tile->rotationOf[k] == tile->rotationCount) {
+            tile->rotations[tile->rotationCount++] = candidate;
+        }
+    }
+}
+
+/*
+ * Rotation table helper. Takes a rotation entry, a rotated tile and the
+ * angle it was rotated by, and fills the entry with the packed mask and
+ * bounding box of the rotated tile's filled cells.
+ */
+void set_rotation(Rotation* rotation, Tile* rotated, int angle) {
+    rotation->mask = 0;
+    rotation->angle = angle;
+    rotation->top = rotation->left = TILE_HEIGHT; //Empty until cells found
+    rotation->bottom = rotation->right = -1;
+    memset(rotation->rows, 0, sizeof(rotation->rows));
+
+    for (int i = 0; i < TILE_HEIGHT; i++) {
+        for (int j = 0; j < TILE_WIDTH; j++) {
+            if (rotated->tileData[i][j] != '!') {
+                continue;
+            }
+            rotation->mask |= (uint32_t) 1 << (i * TILE_WIDTH + j);
+            rotation->rows[i] |= (uint64_t) 1 << j;
+            rotation->top = (i < rotation->top) ? i : rotation->top;
+            rotation->bottom = (i > rotation->bottom) ? i : rotation->bottom;
+            rotation->left = (j < rotation->left) ? j : rotation->left;
+            rotation->right = (j > rotation->right) ? j : rotation->right;
+        }
+    }
+}
+
+/*
+ * Takes a tile and a valid rotation angle (0, 90, 180, 270), and returns
+ * the tile's rotation table entry for that angle.
+ */
+Rotation* tile_rotation(Tile* tile, int angle) {
+    return &(tile->rotations[tile->rotationOf[angle / ROTATION_STEP]]);
+}
+
+/*
+ * Takes a tile and a rotation angle, and returns the next larger angle 
+ * which gives a shape not already given by a smaller angle. Returns
+ * ROTATION_COUNT * ROTATION_STEP if there is none.
+ */
+int next_rotation_angle(Tile* tile, int angle) {
+    for (angle += ROTATION_STEP; angle <= MAX_ANGLE; angle += ROTATION_STEP) {
+        if (tile_rotation(tile, angle)->angle == angle) {
+            break;
+        }
+    }
+    return angle;
+}
+
+/*
+ * Printing functions. Takes a Variable Length Array of Tiles 
+ * and their rotations, where the number of tiles may vary between 
+ * games. Prints each rotation of the tile to stdout sequentially,
+ * separating different tiles with a newline.
+ */
+void print_tile_rotations(int tileNum, Tile tiles[tileNum][ROTATION_COUNT]) {
+    for (int k = 0; k < tileNum; k++) {
+        for (int i = 0; i < TILE_HEIGHT; i++) {
+
+            int rotationCount = 0; //Used to print out the fixed 4 rotations
+
+            for (int j = 0; j < TILE_WIDTH; j++) {
+                printf("%c", tiles[k][rotationCount].tileData[i][j]);
+            }
+
+            rotationCount++;
+            printf(" ");
+
+            for (int j = 0; j < TILE_WIDTH; j++) {
+                printf("%c", tiles[k][rotationCount].tileData[i][j]);
+            }
+
+            rotationCount++;
+            printf(" ");
+
+            for (int j = 0; j < TILE_WIDTH; j++) {
+                printf("%c", tiles[k][rotationCount].tileData[i][j]);
+            }   
+            rotationCount++;
+            printf(" ");
+
+            for (int j = 0; j < TILE_WIDTH; j++) {
+                printf("%c", tiles[k][rotationCount].tileData[i][j]);
+           
+            }
+            printf("\n");
+        }
+        if (k != (tileNum - 1)) {
+            printf("\n");
+        }
+    }
+}
+
+/*
+ * Creation function. Takes the specified height and width of a game board,
+ * and a pointer to an uninitalized board. Creates an empty board defined by 
+ * these dimensions, with every cell outside of it marked as occupied.
+ */
+void create_new_grid(int height, int width, Board* grid) { 
+    create_arena_grid(height, width, grid, NULL);
+}
+
+/*
+ * Creation function, as per create_new_grid, but takes the board's memory
+ * (and its move index's, once built) from the given arena, or from the 
+ * heap if the arena is NULL.
+ */
+void create_arena_grid(int height, int width, Board* grid, Arena* arena) {
+    int paddedRows = height + 2 * BOARD_PAD;
+    COUNT(grids, 1);
+    grid->height = height;
+    grid->width = width;
+    grid->rowWords = (width + 2 * BOARD_PAD + WORD_BITS - 1) / WORD_BITS + 1;
+    grid->index = NULL;
+    grid->prefix = NULL;
+    grid->arena = arena;
+    grid->planes = (uint64_t*) board_calloc(grid, (size_t) PLANE_COUNT * 
+            paddedRows * grid->rowWords, sizeof(uint64_t)); //One block
+
+    for (int i = -BOARD_PAD; i < height + BOARD_PAD; i++) { //Build the wall
+        uint64_t* rowBits = board_row(grid, OCCUPIED_PLANE, i);
+        for (int j = 0; j < grid->rowWords; j++) {
+            rowBits[j] = ~(uint64_t) 0;
+        }
+        if (i < 0 || i >= height) {
+            continue; //Padding rows are entirely wall
+        }
+        for (int j = 0; j < width; j++) { //Open up the playable cells
+            int pos = j + BOARD_PAD;
+            rowBits[pos / WORD_BITS] &= ~((uint64_t) 1 << (pos % WORD_BITS));
+        }
+    }
+}
+
+/*
+ * Memory helper. Takes a gameboard and a number of items of a size, and 
+ * returns zeroed memory for them from the board's arena, or from the heap
+ * if it has none.
+ */
+void* board_calloc(Board* grid, size_t count, size_t size) {
+    if (grid->arena == NULL) {
+        return calloc(count, size);
+    }
+    return arena_calloc(grid->arena, count, size);
+}
+
+/*
+ * Arena setup function. Takes an uninitialised arena and leaves it empty;
+ * nothing is taken from the heap until the first allocation.
+ */
+void arena_init(Arena* arena) {
+    arena->block = NULL;
+    arena->used = arena->total = 0;
+    arena->heapAllocations = arena->allocations = 0;
+}
+
+/*
+ * Allocation function. Takes an arena and a number of bytes, and returns 
+ * that many (uninitialised) bytes from the arena, aligned to ARENA_ALIGN.
+ * Only when the newest block is too full does it take a new block from 
+ * the heap, at least as large as every block so far put together.
+ */
+void* arena_alloc(Arena* arena, size_t bytes) {
+    bytes = (bytes + ARENA_ALIGN - 1) & ~(size_t) (ARENA_ALIGN - 1);
+    if (arena->block == NULL || arena->used + bytes > arena->block->size) {
+        size_t size = 2 * arena->total;
+        size = (size < bytes) ? bytes : size;
+        arena_grow(arena, (size < ARENA_MIN_BLOCK) ? ARENA_MIN_BLOCK : size);
+    }
+
+    void* memory = (char*) arena->block + ARENA_HEADER + arena->used;
+    arena->used += bytes;
+    arena->allocations++;
+    return memory;
+}
+
+/*
+ * Allocation function, as per arena_alloc, for a number of items of a 
+ * size. Zeroes the memory returned, like calloc.
+ */
+void* arena_calloc(Arena* arena, size_t count, size_t size) {
+    void* memory = arena_alloc(arena, count * size);
+    memset(memory, 0, count * size);
+    return memory;
+}
+
+/*
+ * Arena helper. Takes an arena and a number of bytes, and takes a new 
+ * block of that size from the heap for the arena to hand out from next.
+ */
+void arena_grow(Arena* arena, size_t size) {
+    ArenaBlock* block = (ArenaBlock*) malloc(ARENA_HEADER + size);
+    block->previous = arena->block;
+    block->size = size;
+    arena->block = block;
+    arena->used = 0;
+    arena->total += size;
+    arena->heapAllocations++;
+}
+
+/*
+ * Takes an arena and returns a mark of how much of it is in use, for 
+ * arena_release to return to.
+ */
+ArenaMark arena_mark(Arena* arena) {
+    ArenaMark mark = {arena->block, arena->used};
+    return mark;
+}
+
+/*
+ * Memory function. Takes an arena and a mark made on it, and gives back 
+ * everything allocated since the mark was made (marks made after it are
+ * given back too). A block taken since the mark holds nothing older, so 
+ * it is kept and handed out again from its start.
+ */
+void arena_release(Arena* arena, ArenaMark mark) {
+    arena->used = (arena->block == mark.block) ? mark.used : 0;
+}
+
+/*
+ * Memory function. Takes an arena and gives back everything allocated 
+ * from it. If it has taken more than one block, they are replaced with a
+ * single block as large as all of them, so that it can hand out as much
+ * again without going back to the heap.
+ */
+void arena_reset(Arena* arena) {
+    if (arena->block != NULL && arena->block->previous != NULL) {
+        size_t total = arena->total;
+        arena_free(arena);
+        arena_grow(arena, total);
+    }
+    arena->used = 0;
+}
+
+/*
+ * Memory function. Takes an arena and returns all of its blocks to the 
+ * heap, leaving it empty. Its counts are kept.
+ */
+void arena_free(Arena* arena) {
+    while (arena->block != NULL) {
+        ArenaBlock* previous = arena->block->previous;
+        free(arena->block);
+        arena->block = previous;
+    }
+    arena->used = arena->total = 0;
+}
+
+/*
+ * Bitboard helper. Takes a board, a plane index and a board row (which may
+ * lie within the padding around the board), and returns a pointer to the
+ * first word of that row's mask inside the plane.
+ */
+uint64_t* board_row(Board* board, int plane, int row) {
+    size_t paddedRows = board->height + 2 * BOARD_PAD;
+    return board->planes + (plane * paddedRows + row + BOARD_PAD) * 
+            board->rowWords;
+}
+
+/*
+ * Bitboard helper. Takes a board, a plane index and a board row and column,
+ * and returns the TILE_WIDTH bits of the plane starting at that column, 
+ * with bit j holding column (col + j).
+ */
+unsigned int board_window(Board* board, int plane, int row, int col) {
+    uint64_t* rowBits = board_row(board, plane, row);
+    int pos = col + BOARD_PAD;
+    int word = pos / WORD_BITS, bit = pos % WORD_BITS;
+    uint64_t window = rowBits[word] >> bit;
+
+    if (bit > WORD_BITS - TILE_WIDTH) { //Window runs into the next word
+        window |= rowBits[word + 1] << (WORD_BITS - bit);
+    }
+    return (unsigned int) (window & TILE_ROW_MASK);
+}
+
+/*
+ * Bitboard helper. Takes a board, a plane index, a board row and column,
+ * and a TILE_WIDTH bit mask laid out as per board_window. Marks every set
+ * bit of the mask as occupied within the plane.
+ */
+void board_stamp(Board* board, int plane, int row, int col, 
+        unsigned int bits) {
+    uint64_t* rowBits = board_row(board, plane, row);
+    int pos = col + BOARD_PAD;
+    int word = pos / WORD_BITS, bit = pos % WORD_BITS;
+    rowBits[word] |= (uint64_t) bits << bit;
+
+    if (bit > WORD_BITS - TILE_WIDTH) {
+        rowBits[word + 1] |= (uint64_t) bits >> (WORD_BITS - bit);
+    }
+}
+
+/*
+ * Bitboard helper. Takes a board, a plane index, a board row and column,
+ * and a TILE_WIDTH bit mask laid out as per board_window. Marks every set
+ * bit of the mask as empty within the plane. Undoes board_stamp.
+ */
+void board_clear(Board* board, int plane, int row, int col, 
+        unsigned int bits) {
+    uint64_t* rowBits = board_row(board, plane, row);
+    int pos = col + BOARD_PAD;
+    int word = pos / WORD_BITS, bit = pos % WORD_BITS;
+    rowBits[word] &= ~((uint64_t) bits << bit);
+
+    if (bit > WORD_BITS - TILE_WIDTH) {
+        rowBits[word + 1] &= ~((uint64_t) bits >> (WORD_BITS - bit));
+    }
+}
 
-        if (pos == tileCount) { //Memory buffer
-            tileCount *= 2; //Double # of tiles
-            tiles = realloc(tiles, sizeof(Tile*) * tileCount);
-        }
+/*
+ * Takes a player icon and returns the board plane storing that player's
+ * cells. Icons without a plane of their own only mark the occupancy plane.
+ */
+int icon_plane(char icon) {
+    switch (icon) {
+        case '*':
+            return 1;
+        case '#':
+            return 2;
+        default:
+            return OCCUPIED_PLANE;
     }
+}
 
-    check_tile_contents(loadFlag, pos, col, row);
-    *numTiles = pos; //# of inner tiles malloc'd
-    fclose(*tileFile);
-    *tileFile = NULL; //Dont let this dangle in case we need to load save
-    return tiles;
+/*
+ * Takes a board and a cell on it, and returns the char that represents 
+ * the cell: the icon of the player holding it, or '.' if it is empty.
+ */
+char get_cell(Board* board, int row, int col) {
+    if (board_window(board, 1, row, col) & 1) {
+        return '*';
+    } else if (board_window(board, 2, row, col) & 1) {
+        return '#';
+    }
+    return '.';
 }
 
 /*
- * Printing function. Takes an array of filled Tile structs, and the 
- * number of tiles read in by fitz. 
- * For every tile in the array, print it alongside its three
- * rotated forms to stdout.
+ * Takes a board, a cell on it, and a valid grid char ('.', '*', '#'), and
+ * updates the cell to match. Only used on empty cells.
  */
-void print_rotations(Tile** tiles, int numTiles) {
-    Tile rotatedTiles[numTiles][ROTATION_COUNT]; //4 rotations of 90 possible
-    
-    for (int i = 0; i < numTiles; i++) {
-        rotatedTiles[i][0] = *tiles[i]; //First tile needs no rotation
-        for (int j = 1; j < ROTATION_COUNT; j++) {
-            rotatedTiles[i][j] = rotate_tile(tiles[i], j); 
-        }
+void set_cell(Board* board, int row, int col, char icon) {
+    int plane = icon_plane(icon);
+    if (plane != OCCUPIED_PLANE) {
+        board_stamp(board, OCCUPIED_PLANE, row, col, 1);
+        board_stamp(board, plane, row, col, 1);
     }
+}
 
-    print_tile_rotations(numTiles, rotatedTiles);
+/*
+ * Takes a row of a board plane (or index bitmap) and a column, and returns
+ * 1 if the column's bit is set, 0 otherwise.
+ */
+int test_bit(uint64_t* rowBits, int col) {
+    int pos = col + BOARD_PAD;
+    return (rowBits[pos / WORD_BITS] >> (pos % WORD_BITS)) & 1;
 }
 
 /*
- * Rotation function. Takes a tile to be rotated and a specified number
- * of rotations. Rotates the tile by this number of rotations
- * in increments of 90 degrees, and returns the rotated tile.
+ * Index creation function. Takes a gameboard, the set of tiles for the
+ * game and the number of tiles. Builds a legal move index of every tile 
+ * shape against the board and attaches it to the board. Leaves the board
+ * without an index if it would need more than MAX_INDEX_WORDS words.
  */
-Tile rotate_tile(Tile* tileStart, int numRotations) { 
-    char tileCopy[TILE_HEIGHT][TILE_WIDTH];
-    char tile[TILE_HEIGHT][TILE_WIDTH];
-    if (numRotations == 0) {
-        return *tileStart;
+void build_move_index(Board* grid, Tile** tiles, int numTiles) {
+    int numShapes = 0;
+    for (int t = 0; t < numTiles; t++) {
+        if (tiles[t]->shape->id >= numShapes) {
+            numShapes = tiles[t]->shape->id + 1;
+        }
     }
-    memcpy(tile, tileStart->tileData, sizeof(tile)); //Load tileData into mem
-    for (int i = 0; i < numRotations; i++) {
-        for (int j = 0; j < TILE_HEIGHT; j++) {
-            for (int k = 0; k < TILE_WIDTH; k++) {
-                tileCopy[j][k] = tile[k][j]; //Swap rows/cols
-            }
+    size_t planeWords = (size_t) (grid->height + 2 * BOARD_PAD) * 
+            grid->rowWords;
+    if (planeWords * numShapes * ROTATION_COUNT > MAX_INDEX_WORDS) {
+        return; //Too large; check_game_over falls back to scanning
+    }
+
+    MoveIndex* index = (MoveIndex*) board_calloc(grid, 1, sizeof(MoveIndex));
+    index->shapes = tiles[0]->shape; //Shape 0 starts the shape block
+    index->numShapes = numShapes;
+    index->legalCount = (long*) board_calloc(grid, numShapes, sizeof(long));
+    index->legal = (uint64_t*) board_calloc(grid, planeWords * numShapes * 
+            ROTATION_COUNT, sizeof(uint64_t));
+    grid->index = index;
+
+    for (int s = 0; s < numShapes; s++) {
+        index_shape(grid, &(index->shapes[s]));
+    }
+}
+
+/*
+ * Index helper. Takes a gameboard with an index, a shape number, a 
+ * rotation of that shape and a board row, and returns a pointer to that 
+ * row of the rotation's legality bitmap.
+ */
+uint64_t* index_row(Board* grid, int shapeNum, int rotation, int row) {
+    size_t paddedRows = grid->height + 2 * BOARD_PAD;
+    size_t plane = (size_t) shapeNum * ROTATION_COUNT + rotation;
+    return grid->index->legal + (plane * paddedRows + row + BOARD_PAD) * 
+            grid->rowWords;
+}
+
+/*
+ * Index helper. Takes a gameboard with an index and a shape, and tests 
+ * every rotation of the shape at every position on the board, recording
+ * the legal ones in the shape's bitmaps and legal move count. A rotation
+ * with no filled cells always has exactly one move counted for it.
+ */
+void index_shape(Board* grid, Shape* shape) {
+    for (int k = 0; k < shape->rotationCount; k++) {
+        Rotation* rotation = &(shape->rotations[k]);
+        if (rotation->top > rotation->bottom) {
+            grid->index->legalCount[shape->id]++; //Fits anywhere
+            continue;
         }
-    
-        for (int j = 0; j < TILE_HEIGHT; j++) {
-            for (int k = 0; k < TILE_WIDTH / 2; k++) { //Mirror grid
-                char tmp = tileCopy[j][k]; //Minus 1 for 0 based index
-                tileCopy[j][k] = tileCopy[j][(TILE_WIDTH - 1) - k]; 
-                tileCopy[j][(TILE_WIDTH - 1) - k] = tmp; 
+
+        int lastRow = grid->height - (rotation->bottom - rotation->top) - 1;
+        int lastCol = grid->width - (rotation->right - rotation->left) - 1;
+        for (int i = 0; i <= lastRow; i++) {
+            uint64_t* rowBits = index_row(grid, shape->id, k, i);
+            COUNT(indexChecks, lastCol + 1);
+            for (int j = 0; j <= lastCol; j++) {
+                if (tile_fits(grid, rotation, i - rotation->top, 
+                        j - rotation->left)) {
+                    int pos = j + BOARD_PAD;
+                    rowBits[pos / WORD_BITS] |= (uint64_t) 1 << 
+                            (pos % WORD_BITS);
+                    grid->index->legalCount[shape->id]++;
+                }
             }
         }
-        memcpy(tile, tileCopy, sizeof(tileCopy)); //Allows further rotations
     }
-    Tile rotatedTile;
-    memcpy(rotatedTile.tileData, tileCopy, sizeof(tileCopy));
-    return rotatedTile;
-} 
+}
 
 /*
- * Printing functions. Takes a Variable Length Array of Tiles 
- * and their rotations, where the number of tiles may vary between 
- * games. Prints each rotation of the tile to stdout sequentially,
- * separating different tiles with a newline.
+ * Index update function. Takes a gameboard with an index, the rotation
+ * that was just placed on it, and the board coordinates of that tile's 
+ * top left corner. Rechecks only the indexed placements whose bounding
+ * box overlaps the placed cells, clearing those which no longer fit.
  */
-void print_tile_rotations(int tileNum, Tile tiles[tileNum][ROTATION_COUNT]) {
-    for (int k = 0; k < tileNum; k++) {
-        for (int i = 0; i < TILE_HEIGHT; i++) {
-
-            int rotationCount = 0; //Used to print out the fixed 4 rotations
-
-            for (int j = 0; j < TILE_WIDTH; j++) {
-                printf("%c", tiles[k][rotationCount].tileData[i][j]);
+void update_move_index(Board* grid, Rotation* placed, int rowOffset, 
+        int colOffset) {
+    MoveIndex* index = grid->index;
+
+    for (int s = 0; s < index->numShapes; s++) {
+        Shape* shape = &(index->shapes[s]);
+        for (int k = 0; k < shape->rotationCount; k++) {
+            Rotation* rotation = &(shape->rotations[k]);
+            int rowStart = rowOffset + placed->top - 
+                    (rotation->bottom - rotation->top);
+            int colStart = colOffset + placed->left - 
+                    (rotation->right - rotation->left);
+
+            for (int i = rowStart; i <= rowOffset + placed->bottom; i++) {
+                uint64_t* rowBits = index_row(grid, s, k, i);
+                for (int j = colStart; j <= colOffset + placed->right; j++) {
+                    int pos = j + BOARD_PAD;
+                    if (!test_bit(rowBits, j)) {
+                        continue; //Already gone
+                    }
+                    COUNT(indexChecks, 1);
+                    if (!tile_fits(grid, rotation, i - rotation->top, 
+                            j - rotation->left)) {
+                        rowBits[pos / WORD_BITS] &= ~((uint64_t) 1 << 
+                                (pos % WORD_BITS));
+                        index->legalCount[s]--;
+                    }
+                }
             }
+        }
+    }
+}
 
-            rotationCount++;
-            printf(" ");
+/*
+ * Memory function. Takes a gameboard and frees its legal move index, if
+ * it has one. An index in an arena is left for the arena to give back.
+ */
+void free_move_index(Board* grid) {
+    if (grid->index == NULL || grid->arena != NULL) {
+        grid->index = NULL;
+        return;
+    }
+    free(grid->index->legalCount);
+    free(grid->index->legal);
+    free(grid->index);
+    grid->index = NULL;
+}
 
-            for (int j = 0; j < TILE_WIDTH; j++) {
-                printf("%c", tiles[k][rotationCount].tileData[i][j]);
-            }
+/*
+ * Prefix count creation function. Takes a gameboard and attaches running
+ * counts of its occupied cells to it: for every padded row, entry c holds
+ * the number of occupied cells (wall included) in the row's first c 
+ * padded columns. The cells between two columns of a row can then be 
+ * counted with two lookups, however far apart they are.
+ */
+void build_prefix_counts(Board* grid) {
+    size_t rowLength = grid->width + 2 * BOARD_PAD + 1;
+    grid->prefix = (int*) board_calloc(grid, rowLength * 
+            (grid->height + 2 * BOARD_PAD), sizeof(int));
+    update_prefix_counts(grid, -BOARD_PAD, grid->height + BOARD_PAD - 1);
+}
 
-            rotationCount++;
-            printf(" ");
+/*
+ * Prefix count helper. Takes a gameboard with prefix counts and a board 
+ * row (which may lie within the padding around the board), and returns a
+ * pointer to that row's counts.
+ */
+int* prefix_row(Board* grid, int row) {
+    return grid->prefix + (size_t) (row + BOARD_PAD) * 
+            (grid->width + 2 * BOARD_PAD + 1);
+}
 
-            for (int j = 0; j < TILE_WIDTH; j++) {
-                printf("%c", tiles[k][rotationCount].tileData[i][j]);
-            }   
-            rotationCount++;
-            printf(" ");
+/*
+ * Prefix count update function. Takes a gameboard with prefix counts and
+ * a range of its rows (inclusive), and recounts the occupied cells along
+ * each of those rows from its occupancy mask.
+ */
+void update_prefix_counts(Board* grid, int firstRow, int lastRow) {
+    int paddedCols = grid->width + 2 * BOARD_PAD;
+    for (int i = firstRow; i <= lastRow; i++) {
+        uint64_t* rowBits = board_row(grid, OCCUPIED_PLANE, i);
+        int* counts = prefix_row(grid, i);
+        counts[0] = 0;
+        for (int c = 0; c < paddedCols; c++) { //Bit c is padded column c
+            counts[c + 1] = counts[c] + 
+                    (int) ((rowBits[c / WORD_BITS] >> (c % WORD_BITS)) & 1);
+        }
+    }
+}
 
-            for (int j = 0; j < TILE_WIDTH; j++) {
-                printf("%c", tiles[k][rotationCount].tileData[i][j]);
-           
-            }
-            printf("\n");
+/*
+ * Rejection check function. Takes a gameboard with prefix counts, a tile
+ * rotation and the board coordinates of its top left corner (as per 
+ * tile_fits). For each row of the tile, counts the empty board cells 
+ * between the row's first and last filled cells. Returns 0 if any row has
+ * fewer empty cells there than it has filled cells, so the tile can't 
+ * fit; 1 if the tile might fit.
+ */
+int enough_free(Board* grid, Rotation* rotation, int rowOffset, 
+        int colOffset) {
+    for (int i = rotation->top; i <= rotation->bottom; i++) {
+        uint64_t cells = rotation->rows[i];
+        if (cells == 0) {
+            continue;
         }
-        if (k != (tileNum - 1)) {
-            printf("\n");
+        int first = __builtin_ctzll(cells);
+        int last = WORD_BITS - 1 - __builtin_clzll(cells);
+        int* counts = prefix_row(grid, rowOffset + i);
+        int start = colOffset + first + BOARD_PAD;
+        int occupied = counts[colOffset + last + BOARD_PAD + 1] - 
+                counts[start];
+        if (last - first + 1 - occupied < __builtin_popcountll(cells)) {
+            return 0;
         }
     }
+    return 1;
 }
 
 /*
- * Creation function. Takes the specified height and width of a game board,
- * and a pointer to an uninitalized board. Creates a board defined by these
- * dimensions and fills it with '.' chars.
+ * Memory function. Takes a gameboard and frees its prefix counts, if it
+ * keeps them. Counts in an arena are left for the arena to give back.
  */
-void create_new_grid(int height, int width, char*** grid) { 
-    *grid = (char**) malloc(sizeof(char*) * height); //Bring us back to char**
+void free_prefix_counts(Board* grid) {
+    if (grid->prefix != NULL && grid->arena == NULL) {
+        free(grid->prefix);
+    }
+    grid->prefix = NULL;
+}
 
-    for (int i = 0; i < height; i++) { //Create grid in memory
-        (*grid)[i] = (char*) malloc(sizeof(char) * width);
+/*
+ * Printing function. Takes the current gameboard and the game's renderer,
+ * and prints the board's contents to stdout with a single write. In diff
+ * mode only the first frame is printed whole; after that each row that
+ * changed since the last frame is printed after its row number.
+ */
+void print_grid(Board* grid, Renderer* renderer) {
+    size_t lineLength = grid->width + 1; //Cells then a newline
+    if (renderer->frame == NULL) {
+        renderer->frame = (char*) malloc(grid->height * lineLength);
+        renderer->output = (char*) malloc(grid->height * 
+                (lineLength + ROW_LABEL_WIDTH));
     }
-    
-    for (int i = 0; i < height; i++) { //Fill it with dots
-        for (int j = 0; j < width; j++) {
-            (*grid)[i][j] = '.';
+    int whole = !renderer->diff || !renderer->drawn;
+    char* out = renderer->output;
+
+    for (int i = 0; i < grid->height; i++) {
+        char* last = renderer->frame + i * lineLength;
+        int labelLength = whole ? 0 : sprintf(out, "%d ", i);
+        render_row(grid, i, out + labelLength);
+        if (whole || memcmp(last, out + labelLength, lineLength)) {
+            memcpy(last, out + labelLength, lineLength);
+            out += labelLength + lineLength; //Keep this row
         }
     }
+
+    fwrite(renderer->output, sizeof(char), out - renderer->output, stdout);
+    COUNT(printBytes, out - renderer->output);
+    renderer->drawn = 1;
 }
 
 /*
- * Printing function. Takes a boards height and width,
- * as well as a copy of the current gameboard, and
- * prints it's contents to stdout.
+ * Printing helper. Takes a gameboard, one of its rows and a line to fill,
+ * and writes the row's cells into the line followed by a newline. Works 
+ * from the player planes a word at a time.
  */
-void print_grid(int height, int width, char** grid) {
-    for (int i = 0; i < height; i++) {
-        for (int j = 0; j < width; j++) {
-            printf("%c", grid[i][j]);
+void render_row(Board* grid, int row, char* line) {
+    memset(line, '.', grid->width);
+    line[grid->width] = '\n';
+
+    for (int plane = 1; plane < PLANE_COUNT; plane++) {
+        char icon = (plane == icon_plane('*')) ? '*' : '#';
+        uint64_t* rowBits = board_row(grid, plane, row);
+        for (int w = 0; w < grid->rowWords; w++) {
+            uint64_t bits = rowBits[w];
+            while (bits != 0) { //Player planes have no wall bits
+                int bit = __builtin_ctzll(bits);
+                line[w * WORD_BITS + bit - BOARD_PAD] = icon;
+                bits &= bits - 1;
+            }
         }
-        printf("\n");
     }
 }
 
+/*
+ * Memory function. Takes a renderer and frees its buffers, leaving it 
+ * ready to draw a new board.
+ */
+void free_renderer(Renderer* renderer) {
+    free(renderer->frame);
+    free(renderer->output);
+    renderer->frame = renderer->output = NULL;
+    renderer->drawn = 0;
+}
+
 /*
  * Exit function. Takes a DataReadFlag (status flag) struct,
  * and exits fitz based upon the value contained within.
@@ -1071,6 +4893,15 @@ int check_load_errors(DataReadFlag statusObj) {
             fprintf(stderr, "Invalid save file contents\n");
             break;
 
+        case 8:
+            fprintf(stderr, "%s %s", "Usage: fitz --batch tilefile p1type", 
+                    "p2type minsize maxsize games [threads]\n");
+            break;
+
+        case 9:
+            fprintf(stderr, "Usage: fitz --replay tilefile journal\n");
+            break;
+
         case 10:
             fprintf(stderr, "End of input\n");
             break;
@@ -1194,24 +5025,86 @@ Player* create_player(char* type, Player* player, DataReadFlag* playerFlag,
 }
 
 /*
- * Loading function. Takes a filepath, a gameboard, an integer
- * array for game data, a status flag struct, a file pointer, the
- * number of tiles being used in this game of fitz, the height and the
- * width of the current gameboard.
+ * Loading function. Takes a filepath, a game set up with the tiles being 
+ * used in this game of fitz, a status flag struct and a file pointer.
  *
  * Attempts to open file and read it's contents. Attempts to validate
- * contents. If successful, game has been loaded into provided data pointers.
- * Else, exits fitz.
+ * contents. If successful, the board, next tile and next player have been
+ * loaded into the game. Else, exits fitz.
+ * Regular files are mapped into memory and loaded a row at a time; 
+ * anything else (e.g. a pipe) is read through the file pointer. Binary 
+ * saves are told apart from text ones by their magic bytes. A move journal
+ * is resumed instead, with the game journalling on to it.
  */
-void load_game(char* saveFileName, char*** grid, int* gameData, 
-        DataReadFlag* saveFlag, FILE** saveFile, int* numTiles, int* height,
-        int* width) {
+void load_game(char* saveFileName, GameState* game, DataReadFlag* saveFlag,
+        FILE** saveFile) {
+    struct stat info;
+    int fd = open(saveFileName, O_RDONLY);
+    if (fd == -1) {
+        saveFlag->returnVal = INVALID_SAVE_FILE;
+        check_load_errors(*saveFlag);
+    }
+
+    char magic[4];
+    if (pread(fd, magic, 4, 0) == 4 && !memcmp(magic, JOURNAL_MAGIC, 4)) {
+        close(fd);
+        resume_journal(saveFileName, game, saveFlag);
+        return;
+    }
+
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        char* data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            close(fd);
+            if (info.st_size >= 4 && !memcmp(data, BINARY_MAGIC, 4)) {
+                ByteSource source = {(unsigned char*) data, info.st_size};
+                source.hash = FNV_OFFSET;
+                load_binary_game(&source, game, saveFlag);
+                if (read_bytes(&source, 1) != NULL) { //Nothing may follow
+                    set_invalid_save(saveFlag);
+                }
+            } else {
+                load_mapped_game(data, info.st_size, game, saveFlag);
+            }
+            munmap(data, info.st_size);
+            return;
+        }
+    }
+    close(fd);
+
     *saveFile = open_file(saveFileName, saveFlag, SAVE_FILE);
-    //READ CONTENTS
+    int c = fgetc(*saveFile);
+    ungetc(c, *saveFile);
+    if (c == BINARY_MAGIC[0]) { //Never starts a valid text save
+        ByteSource source = {NULL, 0, 0, *saveFile};
+        source.hash = FNV_OFFSET;
+        load_binary_game(&source, game, saveFlag);
+        if (read_bytes(&source, 1) != NULL) { //Nothing may follow
+            set_invalid_save(saveFlag);
+        }
+        fclose(*saveFile);
+        *saveFile = NULL;
+        return;
+    }
+    read_save_header(saveFile, game, saveFlag);
+    load_grid(&(game->grid), game->grid.height, game->grid.width, 
+            saveFlag, saveFile); 
+    fclose(*saveFile);
+    *saveFile = NULL; //Dangling pointer
+}
+
+/*
+ * Loading function. Takes a save file opened at its start, a game set up 
+ * with its tiles, and a status flag struct. Reads and checks the save's 
+ * parameter line, hands the next tile and player over to the game, and 
+ * creates its empty board. Exits fitz if the parameters are invalid.
+ */
+void read_save_header(FILE** saveFile, GameState* game, 
+        DataReadFlag* saveFlag) {
     char* parameters = get_params(saveFile, saveFlag); //Checks for clean line
     //Assign the data from the line into the thing
     char* currentPos = parameters; //Pointer to the string for strtol to use
-    long paramVals[4]; //Valid parameters ensures 4 digits to be converted
+    long paramVals[4] = {-1, -1, -1, -1}; //Missing values are invalid
     int index = 0;
     
     while (*currentPos != '\0') { //While there is still content
@@ -1222,16 +5115,275 @@ void load_game(char* saveFileName, char*** grid, int* gameData,
         }
     }
 
-    check_save_params(paramVals, numTiles, saveFlag);
-    gameData[0] = paramVals[0];
-    gameData[1] = paramVals[1]; //Hand over next tile/player
-    *height = (int) paramVals[2];
-    *width = (int) paramVals[3];
-    create_new_grid(*height, *width, &(*grid)); 
-    load_grid(grid, *height, *width, saveFlag, saveFile); 
+    check_save_params(paramVals, &(game->numTiles), saveFlag);
+    game->currentTile = paramVals[0];
+    game->currentPlayer = paramVals[1]; //Hand over next tile/player
+    create_arena_grid((int) paramVals[2], (int) paramVals[3], &(game->grid),
+            &(game->arena));
     free(parameters);
-    fclose(*saveFile);
-    *saveFile = NULL; //Dangling pointer
+}
+
+/*
+ * Loading function. Takes the contents of a save file mapped into memory 
+ * and their size, a game set up with its tiles, and a status flag struct.
+ * Reads the parameter line as load_game does, then checks and loads the 
+ * board a whole row at a time. Exits fitz with the same status load_grid 
+ * would if the board is invalid.
+ */
+void load_mapped_game(char* data, size_t size, GameState* game, 
+        DataReadFlag* saveFlag) {
+    FILE* header = fmemopen(data, size, "r"); //Parameter line is tiny
+    read_save_header(&header, game, saveFlag);
+    size_t pos = ftell(header);
+    fclose(header);
+
+    Board* grid = &(game->grid);
+    for (int i = 0; i < grid->height; i++) {
+        if (size - pos < (size_t) grid->width + 1 || 
+                !load_row(grid, i, data + pos) || 
+                data[pos + grid->width] != '\n') {
+            set_invalid_save(saveFlag); //Short, bad or long row
+        }
+        pos += grid->width + 1;
+    }
+    if (pos != size) { //Data after the last row
+        set_invalid_save(saveFlag);
+    }
+}
+
+/*
+ * Loading function. Takes a binary save (see save_binary) to read from its
+ * start, a game set up with its tiles, and a status flag struct. Checks 
+ * the save and loads the next tile, next player and board into the game, 
+ * decoding the board as it is read. Exits fitz with the invalid save 
+ * contents status if the save is corrupt, of another version, or its 
+ * values are out of range.
+ */
+void load_binary_game(ByteSource* source, GameState* game, 
+        DataReadFlag* saveFlag) {
+    unsigned char* header = read_bytes(source, BINARY_HEADER);
+    if (header == NULL || memcmp(header, BINARY_MAGIC, 4) || 
+            header[4] != BINARY_VERSION || header[5] > RLE_BOARD) {
+        set_invalid_save(saveFlag);
+    }
+    int encoding = header[5], player = header[6];
+    uint32_t tile = 0;
+    for (int i = 0; i < 4; i++) {
+        tile |= (uint32_t) header[8 + i] << (8 * i);
+    }
+    int height = header[12] | (header[13] << 8);
+    int width = header[14] | (header[15] << 8);
+
+    if (player > 1 || tile >= (uint32_t) game->numTiles || height < 1 || 
+            height > MAX_HEIGHT || width < 1 || width > MAX_WIDTH) {
+        set_invalid_save(saveFlag);
+    }
+    game->currentTile = (int) tile;
+    game->currentPlayer = player;
+    create_arena_grid(height, width, &(game->grid), &(game->arena));
+
+    if (encoding == RLE_BOARD) {
+        decode_runs(source, &(game->grid), saveFlag);
+    } else {
+        unpack_board(source, &(game->grid), saveFlag);
+    }
+
+    uint32_t sum = source->hash;
+    unsigned char* stored = read_bytes(source, CHECKSUM_BYTES);
+    if (stored == NULL || (stored[0] | (stored[1] << 8) | 
+            (stored[2] << 16) | ((uint32_t) stored[3] << 24)) != sum) {
+        set_invalid_save(saveFlag);
+    }
+}
+
+/*
+ * Decoding function. Takes a binary save read up to its packed board (see
+ * pack_board), the empty board to fill, and a status flag struct. Reads 
+ * the board a row at a time into the board, exiting fitz if it is cut 
+ * short or holds a cell code that isn't used.
+ */
+void unpack_board(ByteSource* source, Board* grid, DataReadFlag* saveFlag) {
+    size_t rowBytes = (grid->width + 3) / 4;
+
+    for (int i = 0; i < grid->height; i++) {
+        unsigned char* cells = read_bytes(source, rowBytes);
+        if (cells == NULL) {
+            set_invalid_save(saveFlag);
+        }
+        for (int j = 0; j < grid->width; j += 32) {
+            uint64_t stars = 0, hashes = 0;
+            for (int k = 0; k < 8 && j + 4 * k < grid->width; k++) {
+                unsigned int packed = *cells++;
+                if (packed & (packed >> 1) & 0x55) {
+                    set_invalid_save(saveFlag); //Cell code 3 isn't used
+                }
+                stars |= (uint64_t) gather_bits(packed) << (4 * k);
+                hashes |= (uint64_t) gather_bits(packed >> 1) << (4 * k);
+            }
+            int cellsLeft = grid->width - j;
+            if ((stars | hashes) >> (cellsLeft < 32 ? cellsLeft : 32)) {
+                set_invalid_save(saveFlag); //Padding must be empty
+            }
+            stamp_cells(grid, i, j, stars, hashes);
+        }
+    }
+}
+
+/*
+ * Decoding function. Takes a binary save read up to its run length coded 
+ * board (see encode_runs), the empty board to fill, and a status flag 
+ * struct. Reads one run at a time and fills it straight into the board.
+ * Exits fitz if a run is malformed, uses a cell code that isn't used, or
+ * the runs don't cover the board exactly.
+ */
+void decode_runs(ByteSource* source, Board* grid, DataReadFlag* saveFlag) {
+    long cellsLeft = (long) grid->height * grid->width;
+    int row = 0, col = 0;
+
+    while (cellsLeft > 0) {
+        unsigned long value = 0;
+        unsigned char* byte;
+        int shift = 0;
+        do {
+            byte = read_bytes(source, 1);
+            if (byte == NULL || shift == 7 * MAX_VARINT_BYTES) {
+                set_invalid_save(saveFlag);
+            }
+            value |= (unsigned long) (*byte & 0x7F) << shift;
+            shift += 7;
+        } while (*byte & 0x80);
+
+        int code = value & ((1 << RUN_CODE_BITS) - 1);
+        unsigned long length = (value >> RUN_CODE_BITS) + 1;
+        if (code >= CELL_CODE_COUNT || length > 
+                (unsigned long) cellsLeft) {
+            set_invalid_save(saveFlag);
+        }
+        cellsLeft -= length;
+
+        while (length > 0) { //Fill the run a row at a time
+            int part = (length < (unsigned long) (grid->width - col)) ? 
+                    (int) length : grid->width - col;
+            fill_run(grid, row, col, part, code);
+            length -= part;
+            col += part;
+            if (col == grid->width) {
+                col = 0;
+                row++;
+            }
+        }
+    }
+}
+
+/*
+ * Decoding helper. Takes a gameboard, a row and column on it, a number of
+ * cells that fit on the row from there, and a cell code, and gives every
+ * one of those cells to the player the code stands for (if any).
+ */
+void fill_run(Board* grid, int row, int col, int length, int code) {
+    if (code == 0) {
+        return; //Empty cells are already empty
+    }
+    for (int j = col; j < col + length; j += 32) {
+        int part = (col + length - j < 32) ? col + length - j : 32;
+        uint64_t cells = (((uint64_t) 1) << part) - 1;
+        stamp_cells(grid, row, j, (code == 1) ? cells : 0, 
+                (code == 2) ? cells : 0);
+    }
+}
+
+/*
+ * Reading function. Takes a binary save source and a number of bytes (no 
+ * more than MAX_ROW_BYTES), and reads that many bytes on from it, adding 
+ * them to its checksum. Returns the bytes read, which stay valid until 
+ * the next read, or NULL if the save ends first.
+ */
+unsigned char* read_bytes(ByteSource* source, size_t count) {
+    unsigned char* bytes;
+    if (source->data != NULL) {
+        if (source->size - source->pos < count) {
+            return NULL;
+        }
+        bytes = source->data + source->pos;
+        source->pos += count;
+    } else {
+        if (fread(source->buffer, 1, count, source->file) != count) {
+            return NULL;
+        }
+        bytes = source->buffer;
+    }
+    source->hash = checksum(source->hash, bytes, count);
+    return bytes;
+}
+
+/*
+ * Loading function. Takes a gameboard, one of its rows and the row's 
+ * cells as saved, and checks every cell is a valid grid char while 
+ * copying the played cells into the board, 32 (AVX2) or 16 (SSE2) cells 
+ * at a time where fitz was built for it. Returns 1 if the row is valid, 
+ * 0 otherwise.
+ */
+int load_row(Board* grid, int row, const char* cells) {
+    int col = 0;
+#if defined(__AVX2__)
+    for (; col + 32 <= grid->width; col += 32) {
+        __m256i chunk = _mm256_loadu_si256((__m256i*) (cells + col));
+        uint32_t stars = (uint32_t) _mm256_movemask_epi8(
+                _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('*')));
+        uint32_t hashes = (uint32_t) _mm256_movemask_epi8(
+                _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('#')));
+        uint32_t dots = (uint32_t) _mm256_movemask_epi8(
+                _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('.')));
+        if ((stars | hashes | dots) != 0xFFFFFFFFu) {
+            return 0;
+        }
+        stamp_cells(grid, row, col, stars, hashes);
+    }
+#endif
+#if defined(__SSE2__)
+    for (; col + 16 <= grid->width; col += 16) {
+        __m128i chunk = _mm_loadu_si128((__m128i*) (cells + col));
+        uint32_t stars = (uint32_t) _mm_movemask_epi8(
+                _mm_cmpeq_epi8(chunk, _mm_set1_epi8('*')));
+        uint32_t hashes = (uint32_t) _mm_movemask_epi8(
+                _mm_cmpeq_epi8(chunk, _mm_set1_epi8('#')));
+        uint32_t dots = (uint32_t) _mm_movemask_epi8(
+                _mm_cmpeq_epi8(chunk, _mm_set1_epi8('.')));
+        if ((stars | hashes | dots) != 0xFFFFu) {
+            return 0;
+        }
+        stamp_cells(grid, row, col, stars, hashes);
+    }
+#endif
+    for (; col < grid->width; col++) {
+        if (!check_grid_point(cells[col])) {
+            return 0;
+        }
+        set_cell(grid, row, col, cells[col]);
+    }
+    return 1;
+}
+
+/*
+ * Bitboard helper. Takes a board, a row and column on it, and masks of up
+ * to 32 cells from there on held by each player, and marks those cells 
+ * in the players' planes and the occupancy plane.
+ */
+void stamp_cells(Board* grid, int row, int col, uint64_t stars, 
+        uint64_t hashes) {
+    uint64_t masks[PLANE_COUNT] = {stars | hashes, 0, 0};
+    int pos = col + BOARD_PAD;
+    int word = pos / WORD_BITS, bit = pos % WORD_BITS;
+    masks[icon_plane('*')] = stars;
+    masks[icon_plane('#')] = hashes;
+
+    for (int plane = 0; plane < PLANE_COUNT; plane++) {
+        uint64_t* rowBits = board_row(grid, plane, row);
+        rowBits[word] |= masks[plane] << bit;
+        if (bit != 0) {
+            rowBits[word + 1] |= masks[plane] >> (WORD_BITS - bit);
+        }
+    }
 }
 
 /*
@@ -1240,7 +5392,7 @@ void load_game(char* saveFileName, char*** grid, int* gameData,
  * read data from file into gameboard. Exits fitz if unable to do
  * so, as per the specification checks.
  */
-void load_grid(char*** grid, int height, int width, DataReadFlag* saveFlag,
+void load_grid(Board* grid, int height, int width, DataReadFlag* saveFlag,
         FILE** saveFile) {
     int c = 0;
     for (int i = 0; i < height; i++) {
@@ -1251,7 +5403,7 @@ void load_grid(char*** grid, int height, int width, DataReadFlag* saveFlag,
                 break;
                 //Catches short lines  
             } else {
-                (*grid)[i][j] = (char) c;
+                set_cell(grid, i, j, (char) c);
             }
         }
         if (!check_row_end(saveFile)) { //Check end of grid row for \n